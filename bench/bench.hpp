@@ -0,0 +1,90 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <flowcpp/flow.h>
+
+namespace bench {
+
+// Heap allocations made so far, counted by the replaced global operator new in main.cpp.
+extern std::size_t allocations;
+
+// Keeps the optimizer from discarding a computed value.
+template <class T>
+void keep(const T &value) {
+  asm volatile("" : : "g"(&value) : "memory");
+}
+
+// Runs each benchmark a fixed number of times over a fixed workload and reports the median time and the average
+// number of heap allocations per operation. Workloads are deterministic, so allocation counts are exact and
+// comparable across runs; times depend on the machine.
+class suite {
+ public:
+  static constexpr int runs = 5;
+
+  explicit suite(std::string filter) : _filter(std::move(filter)) {}
+
+  template <class F>
+  void run(const std::string &name, std::size_t iterations, F &&op) {
+    if (name.find(_filter) == std::string::npos) return;
+
+    for (std::size_t i = 0; i < iterations / 10; ++i) op(i);
+
+    std::vector<double> ns;
+    auto allocations_before = allocations;
+    for (int r = 0; r < runs; ++r) {
+      auto start = std::chrono::steady_clock::now();
+      for (std::size_t i = 0; i < iterations; ++i) op(i);
+      auto elapsed = std::chrono::steady_clock::now() - start;
+      ns.push_back(std::chrono::duration<double, std::nano>(elapsed).count() / iterations);
+    }
+    auto allocs = static_cast<double>(allocations - allocations_before) / (runs * iterations);
+
+    std::sort(std::begin(ns), std::end(ns));
+    std::cout << std::left << std::setw(56) << name << std::right << std::fixed << std::setprecision(2)
+              << std::setw(12) << ns[runs / 2] << std::setw(12) << allocs << std::endl;
+  }
+
+  static void header() {
+    std::cout << "flow_bench: median of " << runs << " runs, time and heap allocations per operation" << std::endl;
+    std::cout << std::left << std::setw(56) << "benchmark" << std::right << std::setw(12) << "ns/op" << std::setw(12)
+              << "allocs/op" << std::endl;
+  }
+
+ private:
+  std::string _filter;
+};
+
+struct increment_action {
+  flow::any payload() const { return _payload; }
+  flow::any type() const { return _type; }
+  flow::any meta() const { return _meta; }
+  bool error() const { return _error; }
+
+  int _payload = {1};
+  int _type = {0};
+  flow::any _meta;
+  bool _error = false;
+};
+
+struct counter_state {
+  long _counter{0};
+};
+
+inline void counter_reducer(counter_state &state, const flow::action &action) {
+  state._counter += *action.payload_ptr<int>();
+}
+
+void dispatch_benchmarks(suite &s);
+
+void middleware_benchmarks(suite &s);
+
+void selector_benchmarks(suite &s);
+
+}  // namespace bench
@@ -0,0 +1,100 @@
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench.hpp"
+
+namespace bench {
+namespace {
+
+template <class Data>
+struct sized_state {
+  long _counter{0};
+  Data _data;
+};
+
+template <class Data>
+void sized_reducer(sized_state<Data> &state, const flow::action &action) {
+  state._counter += *action.payload_ptr<int>();
+}
+
+std::vector<long> make_data(std::size_t size, std::vector<long>) { return std::vector<long>(size, 1); }
+
+flow::persistent_vector<long> make_data(std::size_t size, flow::persistent_vector<long> data) {
+  for (std::size_t i = 0; i < size; ++i) data = data.push_back(1);
+  return data;
+}
+
+// A subscriber holding on to the last snapshot makes the store copy its state before every dispatch.
+template <class Data>
+void state_size(suite &s, const std::string &name, std::size_t size, bool hold_snapshot) {
+  sized_state<Data> initial;
+  initial._data = make_data(size, Data());
+  auto store = flow::create_store<sized_state<Data>>(sized_reducer<Data>, initial);
+
+  std::shared_ptr<const sized_state<Data>> held;
+  if (hold_snapshot) store.subscribe_snapshot([&](std::shared_ptr<const sized_state<Data>> state) { held = state; });
+
+  flow::action action = increment_action{};
+  s.run(name + "=" + std::to_string(size) + (hold_snapshot ? ",snapshot_held" : ""), size > 4096 ? 2000 : 200000,
+        [&](std::size_t) { store.dispatch(action); });
+}
+
+void subscribers(suite &s, int count) {
+  auto store = flow::create_store<counter_state>(counter_reducer, counter_state{});
+  long sum = 0;
+  std::vector<flow::basic_disposable<>> disposables;
+  for (int i = 0; i < count; ++i) {
+    disposables.push_back(store.subscribe([&](const counter_state &state) { sum += state._counter; }));
+  }
+
+  flow::action action = increment_action{};
+  s.run("dispatch/subscribers=" + std::to_string(count), 200000, [&](std::size_t) { store.dispatch(action); });
+  keep(sum);
+}
+
+// Slice subscribers whose slice never changes only pay for the projection and the comparison.
+void slice_subscribers(suite &s, int count) {
+  struct two_counters {
+    long _counter{0};
+    long _other{0};
+  };
+  auto store = flow::create_store<two_counters>(
+      [](two_counters &state, const flow::action &action) { state._counter += *action.payload_ptr<int>(); },
+      two_counters{});
+  long calls = 0;
+  std::vector<flow::basic_disposable<>> disposables;
+  for (int i = 0; i < count; ++i) {
+    disposables.push_back(
+        store.subscribe([](const two_counters &state) { return state._other; }, [&](long) { ++calls; }));
+  }
+
+  flow::action action = increment_action{};
+  s.run("dispatch/slice_subscribers=" + std::to_string(count), 200000, [&](std::size_t) { store.dispatch(action); });
+  keep(calls);
+}
+
+}  // namespace
+
+void dispatch_benchmarks(suite &s) {
+  for (std::size_t size : {1, 1024, 65536}) state_size<std::vector<long>>(s, "dispatch/state_size", size, false);
+  for (std::size_t size : {1, 1024, 65536}) state_size<std::vector<long>>(s, "dispatch/state_size", size, true);
+  for (std::size_t size : {1, 1024, 65536}) {
+    state_size<flow::persistent_vector<long>>(s, "dispatch/persistent_state_size", size, true);
+  }
+
+  for (int count : {0, 1, 8, 64}) subscribers(s, count);
+  for (int count : {1, 64}) slice_subscribers(s, count);
+
+  flow::action action = increment_action{};
+  s.run("dispatch/construct_action", 200000, [&](std::size_t) {
+    flow::action a = increment_action{};
+    keep(a);
+  });
+  s.run("dispatch/copy_action", 200000, [&](std::size_t) {
+    flow::action a = action;
+    keep(a);
+  });
+}
+
+}  // namespace bench
@@ -0,0 +1,26 @@
+#include <cstdlib>
+#include <new>
+
+#include "bench.hpp"
+
+std::size_t bench::allocations = 0;
+
+void *operator new(std::size_t size) {
+  ++bench::allocations;
+  if (auto p = std::malloc(size ? size : 1)) return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+// Usage: flow_bench [filter], running only the benchmarks whose name contains `filter`.
+int main(int argc, char **argv) {
+  bench::suite s(argc > 1 ? argv[1] : "");
+  bench::suite::header();
+  bench::dispatch_benchmarks(s);
+  bench::middleware_benchmarks(s);
+  bench::selector_benchmarks(s);
+  return 0;
+}
@@ -0,0 +1,73 @@
+#include <string>
+
+#include "bench.hpp"
+
+namespace bench {
+namespace {
+
+enum class counter_action_type { thunk, increment };
+
+auto dynamic_layer = [](flow::basic_middleware<counter_state>) {
+  return [](const flow::dispatch_t &next) { return [next](const flow::action &action) { return next(action); }; };
+};
+
+auto static_layer = [](flow::basic_store<counter_state> &, const flow::action &action, auto &&next) {
+  return next(action);
+};
+
+template <class Store>
+void dispatches(suite &s, const std::string &name, Store &store) {
+  flow::action action = increment_action{};
+  s.run(name, 1000000, [&](std::size_t) { store.dispatch(action); });
+}
+
+}  // namespace
+
+void middleware_benchmarks(suite &s) {
+  auto r = counter_reducer;
+  auto l = dynamic_layer;
+
+  auto dynamic_0 = flow::apply_middleware<counter_state>(r, counter_state{}, {});
+  auto dynamic_1 = flow::apply_middleware<counter_state>(r, counter_state{}, {l});
+  auto dynamic_4 = flow::apply_middleware<counter_state>(r, counter_state{}, {l, l, l, l});
+  auto dynamic_8 = flow::apply_middleware<counter_state>(r, counter_state{}, {l, l, l, l, l, l, l, l});
+  dispatches(s, "middleware/std_function_depth=0", dynamic_0);
+  dispatches(s, "middleware/std_function_depth=1", dynamic_1);
+  dispatches(s, "middleware/std_function_depth=4", dynamic_4);
+  dispatches(s, "middleware/std_function_depth=8", dynamic_8);
+
+  auto t = static_layer;
+  auto static_0 = flow::apply_middleware<counter_state>(r, counter_state{});
+  auto static_1 = flow::apply_middleware<counter_state>(r, counter_state{}, t);
+  auto static_4 = flow::apply_middleware<counter_state>(r, counter_state{}, t, t, t, t);
+  auto static_8 = flow::apply_middleware<counter_state>(r, counter_state{}, t, t, t, t, t, t, t, t);
+  dispatches(s, "middleware/static_depth=0", static_0);
+  dispatches(s, "middleware/static_depth=1", static_1);
+  dispatches(s, "middleware/static_depth=4", static_4);
+  dispatches(s, "middleware/static_depth=8", static_8);
+
+  // thunk support is meant to cost nothing for the actions that are not thunks
+  auto thunk = flow::apply_middleware<counter_state>(
+      r, counter_state{}, {flow::thunk_middleware<counter_state, counter_action_type>});
+  dispatches(s, "middleware/thunk_non_thunk_action", thunk);
+
+  flow::action thunk_action = flow::thunk_action<counter_state, counter_action_type>{
+      [](const flow::dispatch_t &dispatch, const flow::get_state_t<counter_state> &) {
+        for (int i = 0; i < 4; ++i) dispatch(increment_action{});
+      },
+      counter_action_type::thunk,
+      {}};
+  s.run("middleware/thunk_dispatching_4", 200000, [&](std::size_t) { thunk.dispatch(thunk_action); });
+
+  flow::instrumentation metrics;
+  auto instrumented = flow::apply_middleware<counter_state>(r, counter_state{}, metrics.static_middleware());
+  dispatches(s, "middleware/instrumentation_enabled", instrumented);
+  metrics.enable(false);
+  dispatches(s, "middleware/instrumentation_disabled", instrumented);
+
+  auto batched = flow::apply_middleware<counter_state>(
+      r, counter_state{}, {flow::batched_thunk_middleware<counter_state, counter_action_type>});
+  s.run("middleware/batched_thunk_dispatching_4", 200000, [&](std::size_t) { batched.dispatch(thunk_action); });
+}
+
+}  // namespace bench
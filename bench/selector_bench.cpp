@@ -0,0 +1,58 @@
+#include <string>
+#include <tuple>
+
+#include "bench.hpp"
+
+namespace bench {
+namespace {
+
+struct numbers_state {
+  int first_number{0};
+  int second_number{0};
+};
+
+// Hits select from the same state every time; misses select from a new state every time, so unbounded caches keep
+// growing during a miss run.
+template <class Memoize>
+void hit_and_miss(suite &s, const std::string &name, Memoize memoize) {
+  auto first_number_selector =
+      flow::selector<numbers_state, int>{[](const numbers_state &state) { return state.first_number; }};
+  auto second_number_selector =
+      flow::selector<numbers_state, int>{[](const numbers_state &state) { return state.second_number; }};
+  auto multiply = flow::result_func<int, int, int>{[](std::tuple<int, int> params) {
+    return std::get<0>(params) * std::get<1>(params);
+  }};
+
+  auto hit_selector =
+      flow::create_selector(std::make_tuple(first_number_selector, second_number_selector), multiply, memoize);
+  auto hit_state = numbers_state{2, 4};
+  s.run("selector/" + name + "_hit", 200000, [&](std::size_t) { keep(hit_selector(hit_state)); });
+
+  auto miss_selector =
+      flow::create_selector(std::make_tuple(first_number_selector, second_number_selector), multiply, memoize);
+  auto miss_state = numbers_state{0, 3};
+  s.run("selector/" + name + "_miss", 200000, [&](std::size_t) {
+    ++miss_state.first_number;
+    keep(miss_selector(miss_state));
+  });
+}
+
+}  // namespace
+
+void selector_benchmarks(suite &s) {
+  auto int_equals = flow::equality_check<int>{[](int left, int right) { return left == right; }};
+  hit_and_miss(s, "default_memoize", flow::default_memoize<int, int, int>(std::make_tuple(int_equals, int_equals)));
+
+  auto int_key = flow::map_string_key<int>{[](int x) { return std::to_string(x); }};
+  hit_and_miss(s, "map_memoize", flow::map_memoize<int, int, int>(std::make_tuple(int_key, int_key)));
+
+  hit_and_miss(s, "hash_memoize", flow::hash_memoize<int, int, int>());
+
+  auto options = flow::lru_options<int, int, int>();
+  options.max_entries = 64;
+  hit_and_miss(s, "lru_memoize_64", flow::lru_memoize<int, int, int>(options));
+
+  hit_and_miss(s, "identity_memoize", flow::identity_memoize<int, int, int>());
+}
+
+}  // namespace bench
@@ -3,32 +3,118 @@
 #include <memory>
 #include <string>
 #include <type_traits>
+#include <utility>
 
 #include "any.hpp"
+#include "small_buffer.hpp"
+#include "traits.hpp"
+#include "type_id.hpp"
+
+#ifndef FLOW_ACTION_INLINE_SIZE
+#define FLOW_ACTION_INLINE_SIZE (8 * sizeof(void *))
+#endif
 
 namespace flow {
 
-template <class Payload = flow::any, class Type = flow::any, class Meta = flow::any>
+namespace detail {
+
+// A field of a user action, borrowed in place together with the id of its declared type.
+struct borrowed {
+  const void *ptr;
+  type_id_t id;
+};
+
+template <class T>
+borrowed borrow(const T &t) {
+  return {std::addressof(t), type_id<T>()};
+}
+
+// Locate a field of a user action without copying it: prefer an accessor returning a reference, then the
+// conventional `_type` / `_payload` / `_meta` data member, otherwise report that nothing can be borrowed.
+template <class T>
+auto borrow_type(const T &t, priority<2>)
+    -> std::enable_if_t<std::is_lvalue_reference<decltype(t.type())>::value, borrowed> {
+  return borrow(t.type());
+}
+
+template <class T>
+auto borrow_type(const T &t, priority<1>) -> decltype(borrow(t._type)) {
+  return borrow(t._type);
+}
+
+template <class T>
+borrowed borrow_type(const T &, priority<0>) {
+  return {nullptr, nullptr};
+}
+
+template <class T>
+auto borrow_payload(const T &t, priority<2>)
+    -> std::enable_if_t<std::is_lvalue_reference<decltype(t.payload())>::value, borrowed> {
+  return borrow(t.payload());
+}
+
+template <class T>
+auto borrow_payload(const T &t, priority<1>) -> decltype(borrow(t._payload)) {
+  return borrow(t._payload);
+}
+
+template <class T>
+borrowed borrow_payload(const T &, priority<0>) {
+  return {nullptr, nullptr};
+}
+
+template <class T>
+auto borrow_meta(const T &t, priority<2>)
+    -> std::enable_if_t<std::is_lvalue_reference<decltype(t.meta())>::value, borrowed> {
+  return borrow(t.meta());
+}
+
+template <class T>
+auto borrow_meta(const T &t, priority<1>) -> decltype(borrow(t._meta)) {
+  return borrow(t._meta);
+}
+
+template <class T>
+borrowed borrow_meta(const T &, priority<0>) {
+  return {nullptr, nullptr};
+}
+
+// Fields declared as `flow::any` are looked through, so `_meta` holding a T can be borrowed as T as well.
+template <class T>
+const T *borrowed_as(borrowed field) {
+  if (field.id == type_id<T>()) return static_cast<const T *>(field.ptr);
+  if (field.id == type_id<any>()) return static_cast<const any *>(field.ptr)->try_as<T>();
+  return nullptr;
+}
+
+}  // namespace detail
+
+template <class Payload = flow::any, class Type = flow::any, class Meta = flow::any,
+          std::size_t InlineSize = FLOW_ACTION_INLINE_SIZE>
 class basic_action {
  public:
   using payload_t = Payload;
   using type_t = Type;
   using meta_t = Meta;
 
-  template <class T>
-  basic_action(const T &t) : _p(new concrete<T>(t)) {}
+  template <class T, class = std::enable_if_t<!std::is_same<std::decay_t<T>, basic_action>::value>>
+  basic_action(T &&t) : _id(type_id<std::decay_t<T>>()) {
+    _p.template emplace<concrete<std::decay_t<T>>>(std::forward<T>(t));
+  }
+
+  basic_action(basic_action &&action) noexcept : _p(std::move(action._p)), _id(action._id) { action._id = nullptr; }
 
-  basic_action(basic_action &&) = default;
+  basic_action(const basic_action &action) = default;
 
-  basic_action(const basic_action &action) : _p(action._p->copy()) {}
+  basic_action &operator=(const basic_action &action) = default;
 
-  basic_action &operator=(basic_action action) {
+  basic_action &operator=(basic_action &&action) noexcept {
     _p = std::move(action._p);
+    _id = action._id;
+    action._id = nullptr;
     return *this;
   }
 
-  basic_action &operator=(basic_action &&) = default;
-
   type_t type() const { return _p->type(); }
 
   payload_t payload() const { return _p->payload(); }
@@ -37,11 +123,48 @@ class basic_action {
 
   meta_t meta() const { return _p->meta(); }
 
+  // Borrowing accessors: point straight into the wrapped action instead of copying the field out. They return
+  // nullptr when the action exposes neither a reference accessor nor a `_type` / `_payload` / `_meta` member, or
+  // when that field is not a T (or a `flow::any` holding a T).
+  template <class T>
+  const T *type_ptr() const {
+    return detail::borrowed_as<T>(_p->borrow_type());
+  }
+
+  template <class T>
+  const T *payload_ptr() const {
+    return detail::borrowed_as<T>(_p->borrow_payload());
+  }
+
+  template <class T>
+  const T *meta_ptr() const {
+    return detail::borrowed_as<T>(_p->borrow_meta());
+  }
+
+  // Id of the wrapped user action type, e.g. for keying a reducer table by `type_id<increment_action>()`.
+  type_id_t id() const { return _id; }
+
+  template <class T>
+  bool is() const {
+    return _id == type_id<T>();
+  }
+
+  template <class T>
+  const T *try_as() const {
+    return is<T>() ? &static_cast<const concrete<T> *>(_p.get())->_t : nullptr;
+  }
+
  private:
+  struct concept;
+
+  using storage_t = small_buffer<concept, InlineSize>;
+
   struct concept {
     virtual ~concept() = default;
 
-    virtual concept *copy() const = 0;
+    virtual void copy_to(storage_t &storage) const = 0;
+
+    virtual void move_to(storage_t &storage) noexcept = 0;
 
     virtual payload_t payload() const = 0;
 
@@ -50,13 +173,22 @@ class basic_action {
     virtual meta_t meta() const = 0;
 
     virtual bool error() const = 0;
+
+    virtual detail::borrowed borrow_type() const = 0;
+
+    virtual detail::borrowed borrow_payload() const = 0;
+
+    virtual detail::borrowed borrow_meta() const = 0;
   };
 
   template <class T>
   struct concrete : public concept {
-    explicit concrete(T t) : _t(std::move(t)) {}
+    template <class U>
+    explicit concrete(U &&t) : _t(std::forward<U>(t)) {}
 
-    concept *copy() const override { return new concrete(*this); }
+    void copy_to(storage_t &storage) const override { storage.template emplace<concrete>(_t); }
+
+    void move_to(storage_t &storage) noexcept override { storage.template emplace<concrete>(std::move(_t)); }
 
     payload_t payload() const override { return _t.payload(); }
 
@@ -66,10 +198,17 @@ class basic_action {
 
     bool error() const override { return _t.error(); }
 
+    detail::borrowed borrow_type() const override { return detail::borrow_type(_t, detail::priority<2>{}); }
+
+    detail::borrowed borrow_payload() const override { return detail::borrow_payload(_t, detail::priority<2>{}); }
+
+    detail::borrowed borrow_meta() const override { return detail::borrow_meta(_t, detail::priority<2>{}); }
+
     T _t;
   };
 
-  std::unique_ptr<concept> _p;
+  storage_t _p;
+  type_id_t _id{nullptr};
 };
 
 using action = basic_action<>;
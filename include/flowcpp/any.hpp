@@ -1,58 +1,111 @@
 #pragma once
 
+#include <cassert>
 #include <memory>
+#include <type_traits>
+#include <utility>
+
+#include "small_buffer.hpp"
+#include "type_id.hpp"
+
+#ifndef FLOW_ANY_INLINE_SIZE
+#define FLOW_ANY_INLINE_SIZE (3 * sizeof(void *))
+#endif
 
 namespace flow {
 
-class any {
+// `InlineSize` bytes are reserved inside the any itself; values whose wrapper fits there (enums, ints, small PODs)
+// never touch the allocator.
+template <std::size_t InlineSize = FLOW_ANY_INLINE_SIZE>
+class basic_any {
  public:
-  any() = default;
+  basic_any() = default;
 
-  any(const any &other) {
-    if (other._p) _p = std::unique_ptr<concept>(other._p->copy());
-  }
+  basic_any(const basic_any &other) = default;
 
-  template <class T>
-  any(const T &t) : _p(new concrete<T>(t)) {}
+  basic_any(basic_any &&other) noexcept : _p(std::move(other._p)), _id(other._id) { other._id = nullptr; }
 
-  template <class T>
-  any &operator=(T &&t) {
-    _p.reset(new concrete<T>(std::forward<T>(t)));
-    return *this;
+  template <class T, class = std::enable_if_t<!std::is_same<std::decay_t<T>, basic_any>::value>>
+  basic_any(T &&t) : _id(type_id<std::decay_t<T>>()) {
+    _p.template emplace<concrete<std::decay_t<T>>>(std::forward<T>(t));
   }
 
-  any &operator=(any other) {
-    _p = std::move(other._p);
+  template <class T, class = std::enable_if_t<!std::is_same<std::decay_t<T>, basic_any>::value>>
+  basic_any &operator=(T &&t) {
+    // emplace keeps the current value if constructing the new one throws, so the id is only updated once it succeeded
+    _p.template emplace<concrete<std::decay_t<T>>>(std::forward<T>(t));
+    _id = type_id<std::decay_t<T>>();
     return *this;
   }
 
-  any &operator=(any &&other) {
+  basic_any &operator=(const basic_any &other) = default;
+
+  basic_any &operator=(basic_any &&other) noexcept {
     _p = std::move(other._p);
+    _id = other._id;
+    other._id = nullptr;
     return *this;
   }
 
+  // Unchecked access; use `try_as` when the stored type is not known for certain.
   template <class T>
   T &as() {
+    assert(is<T>());
     return static_cast<concrete<T> *>(_p.get())->_t;
   }
 
-  operator bool() const { return (_p)? true : false; }
+  template <class T>
+  const T &as() const {
+    assert(is<T>());
+    return static_cast<const concrete<T> *>(_p.get())->_t;
+  }
+
+  template <class T>
+  T *try_as() {
+    return is<T>() ? &static_cast<concrete<T> *>(_p.get())->_t : nullptr;
+  }
+
+  template <class T>
+  const T *try_as() const {
+    return is<T>() ? &static_cast<const concrete<T> *>(_p.get())->_t : nullptr;
+  }
+
+  template <class T>
+  bool is() const {
+    return _id == type_id<T>();
+  }
+
+  // Id of the stored type, nullptr when empty.
+  type_id_t id() const { return _id; }
+
+  operator bool() const { return (_p) ? true : false; }
 
  private:
+  struct concept;
+
+  using storage_t = small_buffer<concept, InlineSize>;
+
   struct concept {
     virtual ~concept() = default;
-    virtual concept *copy() const = 0;
+    virtual void copy_to(storage_t &storage) const = 0;
+    virtual void move_to(storage_t &storage) noexcept = 0;
   };
 
   template <class T>
   struct concrete : concept {
-    concrete(T const &t) : _t(t) {}
+    template <class U>
+    explicit concrete(U &&t) : _t(std::forward<U>(t)) {}
+
+    void copy_to(storage_t &storage) const override { storage.template emplace<concrete>(_t); }
 
-    concept *copy() const override { return new concrete<T>(*this); }
+    void move_to(storage_t &storage) noexcept override { storage.template emplace<concrete>(std::move(_t)); }
 
     T _t;
   };
 
-  std::unique_ptr<concept> _p;
+  storage_t _p;
+  type_id_t _id{nullptr};
 };
+
+using any = basic_any<>;
 }
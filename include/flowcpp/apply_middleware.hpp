@@ -2,6 +2,7 @@
 
 #include <initializer_list>
 #include <numeric>
+#include <tuple>
 #include <vector>
 
 #include "middleware.hpp"
@@ -9,12 +10,22 @@
 
 namespace flow {
 
-template <class S>
+template <class S, class Reducer>
 basic_store<S> apply_middleware(
-    reducer_t<S> reducer, const S& state,
+    Reducer reducer, const S& state,
     std::initializer_list<std::function<dispatch_transformer_t(basic_middleware<S>)>> transformers) {
   using state_t = S;
-  return basic_store<state_t>(reducer, state, transformers);
+  return basic_store<state_t>(to_in_place_reducer<state_t>(std::move(reducer)), state, transformers);
+}
+
+// Middleware known at compile time, each a callable `middleware(store, action, next)` returning the dispatched action,
+// where `store` is the basic_store (for `state()` and top-level `dispatch`) and `next` forwards to the following
+// middleware or the reducer. The chain is nested statically instead of through one std::function per layer.
+template <class S, class Reducer, class... Middlewares>
+basic_store<S> apply_middleware(Reducer reducer, const S& state, Middlewares... middlewares) {
+  using state_t = S;
+  return basic_store<state_t>(to_in_place_reducer<state_t>(std::move(reducer)), state,
+                              std::make_tuple(std::move(middlewares)...));
 }
 
 }  // namespace flow
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include "action.hpp"
+#include "executor.hpp"
+#include "middleware.hpp"
+
+namespace flow {
+
+template <class T>
+class async_future;
+
+// Producer side of a value an async thunk waits for with `async_context::then`. Unlike std::promise, setting the value
+// runs the waiting continuation right away, on the thread setting it, so no thread has to wait or poll for it.
+template <class T>
+class async_promise {
+ public:
+  async_promise() : _state(std::make_shared<state>()) {}
+
+  // `set_value(value)`, or `set_value()` for async_promise<void>. At most one value or exception is set.
+  template <class... V>
+  void set_value(V &&... value) {
+    _state->promise.set_value(std::forward<V>(value)...);
+    _state->complete();
+  }
+
+  void set_exception(std::exception_ptr exception) {
+    _state->promise.set_exception(std::move(exception));
+    _state->complete();
+  }
+
+  async_future<T> get_future() const { return async_future<T>(_state); }
+
+ private:
+  friend class async_future<T>;
+
+  // The result travels in a std::promise / std::future pair, handed to the continuation once both are present.
+  struct state {
+    void complete() {
+      std::function<void(std::future<T>)> continuation;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        ready = true;
+        continuation = std::move(this->continuation);
+      }
+      if (continuation) continuation(std::move(future));
+    }
+
+    void on_ready(std::function<void(std::future<T>)> f) {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!ready) {
+          continuation = std::move(f);
+          return;
+        }
+      }
+      f(std::move(future));
+    }
+
+    std::mutex mutex;
+    std::promise<T> promise;
+    std::future<T> future{promise.get_future()};
+    std::function<void(std::future<T>)> continuation;
+    bool ready{false};
+  };
+
+  std::shared_ptr<state> _state;
+};
+
+// Consumer side of an async_promise, waited for by handing it to `async_context::then` once.
+template <class T>
+class async_future {
+ public:
+  async_future() = default;
+
+  bool valid() const { return static_cast<bool>(_state); }
+
+ private:
+  template <class>
+  friend class async_promise;
+
+  template <class>
+  friend class async_context;
+
+  explicit async_future(std::shared_ptr<typename async_promise<T>::state> state) : _state(std::move(state)) {}
+
+  std::shared_ptr<typename async_promise<T>::state> _state;
+};
+
+// What an async thunk gets to talk back to the store. Async thunks run on the background executor, so everything
+// touching the store is posted to the foreground executor, which must run tasks on the thread owning the store.
+// A future continues through a callback and a delay waits on a timer thread, so no background thread ever blocks. The
+// context refers to the store and must not outlive it.
+template <class State>
+class async_context {
+ public:
+  async_context(executor_t background, executor_t foreground, dispatch_t dispatch, get_state_t<State> get_state,
+                std::weak_ptr<timer_queue> timers)
+      : _background(std::move(background)),
+        _foreground(std::move(foreground)),
+        _dispatch(std::move(dispatch)),
+        _get_state(std::move(get_state)),
+        _timers(std::move(timers)) {}
+
+  // Any thread.
+  void dispatch(action action) const {
+    auto dispatch = _dispatch;
+    _foreground([dispatch, action] { dispatch(action); });
+  }
+
+  // Any thread: runs `f(const State &)` on the foreground executor with the state at that time.
+  template <class F>
+  void read_state(F f) const {
+    auto get_state = _get_state;
+    _foreground([get_state, f]() mutable { f(get_state()); });
+  }
+
+  // Runs `f()` as a separate task on the background executor.
+  template <class F>
+  void post(F f) const {
+    _background(std::move(f));
+  }
+
+  // Runs `f(std::future<T>)` on the background executor once the promise behind `future` is set, the future then
+  // being ready: `get()` returns the value or rethrows the exception.
+  template <class T, class F>
+  void then(async_future<T> future, F f) const {
+    if (!future._state) return;
+    auto background = _background;
+    future._state->on_ready([background, f](std::future<T> result) {
+      auto ready = std::make_shared<std::future<T>>(std::move(result));
+      background([ready, f]() mutable { f(std::move(*ready)); });
+    });
+  }
+
+  // Runs `f()` on the background executor after `delay`.
+  template <class Rep, class Period, class F>
+  void after(std::chrono::duration<Rep, Period> delay, F f) const {
+    auto timers = _timers.lock();
+    if (!timers) return;
+    auto background = _background;
+    timers->post_after(delay, [background, f] { background(f); });
+  }
+
+ private:
+  executor_t _background;
+  executor_t _foreground;
+  dispatch_t _dispatch;
+  get_state_t<State> _get_state;
+  std::weak_ptr<timer_queue> _timers;
+};
+
+template <class State>
+using async_thunk_t = std::function<void(const async_context<State> &)>;
+
+template <class State>
+struct async_thunk_action {
+  flow::any payload() const { return _payload; }
+  flow::any type() const { return {}; }
+  flow::any meta() const { return _meta; }
+  bool error() const { return _error; }
+
+  async_thunk_t<State> _payload;
+  flow::any _meta;
+  bool _error = false;
+};
+
+// Starts async thunks on `background` and returns without waiting for them; they are recognized by the action's
+// wrapped type and are not passed on to the rest of the chain. Actions they dispatch come back through `foreground`.
+// The middleware owns the timer thread behind `after`; what is still waiting on it when the store is destroyed is
+// dropped.
+template <class State>
+auto make_async_thunk_middleware(executor_t background, executor_t foreground) {
+  auto timers = std::make_shared<timer_queue>();
+  return [background, foreground, timers](flow::basic_middleware<State> middleware) {
+    return [=](const flow::dispatch_t &dispatch) {
+      return [=](const flow::action &action) -> flow::action {
+        auto thunk = action.try_as<async_thunk_action<State>>();
+        if (!thunk) return dispatch(action);
+
+        async_context<State> context(background, foreground, dispatch, middleware.get_state(), timers);
+        auto payload = thunk->_payload;
+        background([context, payload] { payload(context); });
+        return action;
+      };
+    };
+  };
+}
+
+}  // namespace flow
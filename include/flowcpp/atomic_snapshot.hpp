@@ -0,0 +1,93 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace flow {
+
+// Single-writer, multi-reader cell publishing immutable snapshots RCU style. The writer swaps in a new snapshot with
+// one atomic exchange and never waits for readers; readers never lock and never wait for the writer, they only
+// retry when a publication lands mid-read. Replaced snapshots are reclaimed by the writer on its next publication once
+// no reader's hazard pointer refers to them, so a snapshot obtained through `load` stays valid for as long as it is
+// held and the cell itself keeps no more than the replaced snapshots still being read. Each `load` borrows one of
+// `ReaderSlots` hazard slots: loads are wait-free while at most that many threads load at once, beyond that a reader
+// yields until a slot frees up.
+template <class T, std::size_t ReaderSlots = 64>
+class atomic_snapshot {
+ public:
+  explicit atomic_snapshot(std::shared_ptr<const T> initial) : _current(new node{std::move(initial)}) {}
+
+  atomic_snapshot(const atomic_snapshot &) = delete;
+
+  atomic_snapshot &operator=(const atomic_snapshot &) = delete;
+
+  ~atomic_snapshot() {
+    delete _current.load();
+    for (auto n : _retired) delete n;
+  }
+
+  // Any thread.
+  std::shared_ptr<const T> load() const {
+    auto &slot = acquire_slot();
+
+    auto n = _current.load();
+    while (true) {
+      slot.hazard.store(n);
+      auto current = _current.load();
+      if (current == n) break;
+      n = current;
+    }
+
+    auto value = n->value;
+    slot.hazard.store(nullptr);
+    slot.busy.store(false);
+    return value;
+  }
+
+  // Writer thread only.
+  void store(std::shared_ptr<const T> value) {
+    auto previous = _current.exchange(new node{std::move(value)});
+    _retired.push_back(previous);
+    reclaim();
+  }
+
+ private:
+  struct node {
+    std::shared_ptr<const T> value;
+  };
+
+  struct slot {
+    std::atomic<bool> busy{false};
+    std::atomic<const node *> hazard{nullptr};
+  };
+
+  slot &acquire_slot() const {
+    auto start = std::hash<std::thread::id>()(std::this_thread::get_id());
+    for (std::size_t i = 0;; ++i) {
+      auto &s = _slots[(start + i) % ReaderSlots];
+      auto expected = false;
+      if (!s.busy.load(std::memory_order_relaxed) && s.busy.compare_exchange_strong(expected, true)) return s;
+      if (i % ReaderSlots == ReaderSlots - 1) std::this_thread::yield();
+    }
+  }
+
+  void reclaim() {
+    auto still_used = std::partition(std::begin(_retired), std::end(_retired), [this](const node *n) {
+      return std::any_of(std::begin(_slots), std::end(_slots), [n](const slot &s) { return s.hazard.load() == n; });
+    });
+    std::for_each(still_used, std::end(_retired), [](const node *n) { delete n; });
+    _retired.erase(still_used, std::end(_retired));
+  }
+
+  std::atomic<node *> _current;
+  mutable std::array<slot, ReaderSlots> _slots;
+  std::vector<const node *> _retired;
+};
+
+}  // namespace flow
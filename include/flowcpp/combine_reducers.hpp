@@ -0,0 +1,163 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "action.hpp"
+#include "traits.hpp"
+#include "type_id.hpp"
+#include "type_id_map.hpp"
+
+namespace flow {
+
+// Names the I-th element of a tuple state, where a struct state would use a member pointer.
+template <std::size_t I>
+struct element {
+  bool operator==(element) const { return true; }
+};
+
+namespace detail {
+
+template <class State, class M>
+M &slice_of(State &state, M State::*member) {
+  return state.*member;
+}
+
+template <class State, std::size_t I>
+auto &slice_of(State &state, element<I>) {
+  return std::get<I>(state);
+}
+
+// Slice reducers returning void mutate the slice in place and always count as a change. Any other slice reducer gets
+// the current slice and returns the next one, which is only stored, and marked dirty, when it differs per same_value.
+template <class Action, class Slice, class F>
+auto reduce_slice(F &f, Slice &slice, const Action &action, priority<1>)
+    -> std::enable_if_t<std::is_void<decltype(f(slice, action))>::value, bool> {
+  f(slice, action);
+  return true;
+}
+
+template <class Action, class Slice, class F>
+bool reduce_slice(F &f, Slice &slice, const Action &action, priority<0>) {
+  Slice next = f(static_cast<const Slice &>(slice), action);
+  if (same_value(slice, next, priority<2>())) return false;
+  slice = std::move(next);
+  return true;
+}
+
+}  // namespace detail
+
+// Reducer made of slice reducers, each registered for one action type and one member (or tuple element) of the
+// state. An action is routed by its type id to the slice reducers registered for it and nothing else runs, so
+// unrelated slices are never touched. Every slice owns a bit in a 64-bit dirty mask and a version counter; `dirty()`
+// tells which slices changed since it was last read, which subscribers and selectors can test to skip work.
+// Copies share their registrations and dirty state, so the reducer handed to a store can still be queried.
+template <class State>
+class combined_reducer {
+ public:
+  using state_t = State;
+  using mask_t = std::uint64_t;
+
+  combined_reducer() : _table(std::make_shared<table>()) {}
+
+  // `f(Slice &, const Action &)` mutating the slice, or `f(const Slice &, const Action &) -> Slice`.
+  template <class Action, class SliceKey, class F>
+  combined_reducer &on(SliceKey key, F f) {
+    auto index = slice_index(key, true);
+    _table->routes[type_id<Action>()].push_back(
+        {[key, f](state_t &state, const action &action) mutable {
+           return detail::reduce_slice(f, detail::slice_of(state, key), *action.try_as<Action>(),
+                                       detail::priority<1>());
+         },
+         index});
+    return *this;
+  }
+
+  void operator()(state_t &state, const action &action) const {
+    auto &t = *_table;
+    if (t.read) {
+      t.dirty = 0;
+      t.read = false;
+    }
+
+    auto routes = t.routes.find(action.id());
+    if (!routes) return;
+
+    for (auto &r : *routes) {
+      if (!r.reduce(state, action)) continue;
+      t.dirty |= mask_t{1} << r.slice;
+      ++t.versions[r.slice];
+    }
+  }
+
+  // Slices changed by the actions reduced since the mask was last read, all of them before the first read. Reading it
+  // makes the next reduction start a new mask, so subscribers reading it after a batch see every action of the batch.
+  mask_t dirty() const {
+    _table->read = true;
+    return _table->dirty;
+  }
+
+  template <class SliceKey>
+  bool dirty(SliceKey key) const {
+    return (dirty() & mask(key)) != 0;
+  }
+
+  // Bit of a slice in `dirty()`, 0 for a slice no reducer was registered for.
+  template <class SliceKey>
+  mask_t mask(SliceKey key) const {
+    auto index = slice_index(key, false);
+    return index < _table->keys.size() ? mask_t{1} << index : 0;
+  }
+
+  // Number of reductions that changed a slice. Unlike `dirty()`, comparing versions also works across a batch.
+  template <class SliceKey>
+  std::size_t version(SliceKey key) const {
+    auto index = slice_index(key, false);
+    return index < _table->keys.size() ? _table->versions[index] : 0;
+  }
+
+ private:
+  struct route {
+    std::function<bool(state_t &, const action &)> reduce;
+    std::size_t slice;
+  };
+
+  struct table {
+    type_id_map<std::vector<route>> routes;
+    std::vector<std::function<bool(type_id_t, const void *)>> keys;
+    std::vector<std::size_t> versions;
+    mask_t dirty{~mask_t{0}};
+    bool read{false};
+  };
+
+  template <class SliceKey>
+  std::size_t slice_index(SliceKey key, bool add) const {
+    auto &t = *_table;
+    for (std::size_t i = 0; i < t.keys.size(); ++i) {
+      if (t.keys[i](type_id<SliceKey>(), &key)) return i;
+    }
+    if (!add) return t.keys.size();
+
+    if (t.keys.size() == 64) throw std::length_error("flow: combined_reducer supports at most 64 slices");
+    t.keys.push_back([key](type_id_t id, const void *other) {
+      return id == type_id<SliceKey>() && *static_cast<const SliceKey *>(other) == key;
+    });
+    t.versions.push_back(0);
+    return t.keys.size() - 1;
+  }
+
+  std::shared_ptr<table> _table;
+};
+
+template <class State>
+combined_reducer<State> combine_reducers() {
+  return combined_reducer<State>();
+}
+
+}  // namespace flow
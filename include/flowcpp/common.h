@@ -1,6 +1,7 @@
 #pragma once
 
 #include <functional>
+#include <memory>
 #include "disposable.hpp"
 
 namespace flow {
@@ -11,6 +12,10 @@ class basic_store;
 template <class State>
 using reducer_t = std::function<State(State, action)>;
 
+// Reducer mutating the state in place; any reducer handed to a store is adapted to this form.
+template <class State>
+using in_place_reducer_t = std::function<void(State &, const action &)>;
+
 template <class State>
 using store_creator_t =
     std::function<basic_store<State>(reducer_t<State>, State)>;
@@ -19,16 +24,22 @@ template <class State>
 using store_enhancer_t = std::function<store_creator_t<State>(
     store_creator_t<State>)>;
 
-using dispatch_t = std::function<action(action)>;
+using dispatch_t = std::function<action(const action &)>;
 
 using dispatch_transformer_t =
   std::function<dispatch_t(dispatch_t)>;
 
 template <class State>
-using get_state_t = std::function<State()>;
+using get_state_t = std::function<const State &()>;
+
+// Runs the given callable with subscriber notifications coalesced into one after it returns.
+using batch_t = std::function<void(const std::function<void()> &)>;
+
+template <class State>
+using state_subscribe_t = std::function<void(const State &)>;
 
 template <class State>
-using state_subscribe_t = std::function<void(State)>;
+using snapshot_subscribe_t = std::function<void(std::shared_ptr<const State>)>;
 
 template <class State>
 using subscribe_t = std::function<basic_disposable<>(state_subscribe_t<State>)>;
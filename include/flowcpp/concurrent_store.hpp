@@ -0,0 +1,208 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <experimental/optional>
+#include <functional>
+#include <future>
+#include <initializer_list>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include "atomic_snapshot.hpp"
+#include "middleware.hpp"
+#include "mpsc_queue.hpp"
+#include "store.hpp"
+
+namespace flow {
+
+enum class overflow_policy {
+  reject,  // refuse the action, the producer gets `queue_full_error` / `false`
+  block,   // the producer yields until the reducer thread has made room
+};
+
+struct concurrent_options {
+  std::size_t capacity{0};  // maximum number of queued actions, 0 for unbounded
+  overflow_policy overflow{overflow_policy::reject};
+  std::function<void(std::exception_ptr)> on_error;  // failures of callback-style dispatches
+  std::size_t publish_interval{64};  // actions reduced between refreshes of `state()`, also refreshed when idle
+};
+
+class queue_full_error : public std::runtime_error {
+ public:
+  queue_full_error() : std::runtime_error("flow: concurrent store queue is full") {}
+};
+
+// Store accepting actions from any thread. Producers push into a lock-free MPSC queue and return immediately; a single
+// reducer thread owned by the store drains it through the middleware chain and reducer, and runs the subscribers.
+// Anything touching the underlying store (subscribe, dispose) must run on that thread, e.g. through `post`; `state()`
+// may be read from any thread.
+//
+// A reducer or middleware that throws fails its own action only: the future gets the exception, callback dispatches
+// report it to `on_error`, and the following actions are reduced as usual. A reducer taking the state by value cannot
+// change it by throwing; one mutating it in place or taking `State &&` should throw before touching it.
+template <class State>
+class basic_concurrent_store {
+ public:
+  using state_t = State;
+  using action_t = action;
+  using callback_t = std::function<void(const action_t &)>;
+  using task_t = std::function<void(basic_store<state_t> &)>;
+  using transformer_t = std::function<dispatch_transformer_t(basic_middleware<state_t>)>;
+
+  template <class Reducer>
+  basic_concurrent_store(Reducer reducer, state_t initial_state, std::initializer_list<transformer_t> transformers = {},
+                         concurrent_options options = {})
+      : _store(to_in_place_reducer<state_t>(std::move(reducer)), std::move(initial_state), transformers),
+        _options(std::move(options)),
+        _published(_store.snapshot()),
+        _thread([this] { run(); }) {}
+
+  basic_concurrent_store(const basic_concurrent_store &) = delete;
+
+  basic_concurrent_store &operator=(const basic_concurrent_store &) = delete;
+
+  // Runs every action queued so far, then stops the reducer thread.
+  ~basic_concurrent_store() {
+    _stopping.store(true);
+    wake();
+    _thread.join();
+  }
+
+  // Once the future is ready, `state()` includes the action.
+  std::future<action_t> dispatch(action_t action) {
+    std::promise<action_t> promise;
+    auto future = promise.get_future();
+    if (!reserve()) {
+      promise.set_exception(std::make_exception_ptr(queue_full_error()));
+      return future;
+    }
+    enqueue(request{std::move(action), std::move(promise), {}, {}});
+    return future;
+  }
+
+  // Returns false when the action was rejected by the overflow policy. `on_dispatched` runs after the state including
+  // the action is published.
+  bool dispatch(action_t action, callback_t on_dispatched) {
+    if (!reserve()) return false;
+    enqueue(request{std::move(action), {}, std::move(on_dispatched), {}});
+    return true;
+  }
+
+  // Runs `task` on the reducer thread, in order with the queued actions.
+  void post(task_t task) {
+    _pending.fetch_add(1);
+    enqueue(request{{}, {}, {}, std::move(task)});
+  }
+
+  std::size_t pending() const { return _pending.load(); }
+
+  // Latest published state, from any thread without blocking on the reducer. Publishing shares the state with
+  // readers, so the reducer thread copies it before the next reduction (cheap with persistent containers); batching
+  // publications by `publish_interval` bounds that to one copy per burst of actions. A dispatch with a future or a
+  // callback is always published before the producer is told, at the price of that copy.
+  std::shared_ptr<const state_t> state() const { return _published.load(); }
+
+ private:
+  struct request {
+    std::experimental::optional<action_t> action;
+    std::experimental::optional<std::promise<action_t>> promise;
+    callback_t callback;
+    task_t task;
+  };
+
+  bool reserve() {
+    if (_options.capacity == 0) {
+      _pending.fetch_add(1);
+      return true;
+    }
+
+    auto pending = _pending.load();
+    while (true) {
+      if (pending >= _options.capacity) {
+        if (_options.overflow == overflow_policy::reject) return false;
+        std::this_thread::yield();
+        pending = _pending.load();
+        continue;
+      }
+      if (_pending.compare_exchange_weak(pending, pending + 1)) return true;
+    }
+  }
+
+  void enqueue(request r) {
+    _queue.push(std::move(r));
+    if (_sleeping.load()) wake();
+  }
+
+  void wake() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _wakeup.notify_one();
+  }
+
+  void run() {
+    while (true) {
+      auto r = _queue.pop();
+      if (!r) {
+        if (_stopping.load() && _queue.empty()) return;
+
+        _sleeping.store(true);
+        {
+          std::unique_lock<std::mutex> lock(_mutex);
+          _wakeup.wait(lock, [this] { return !_queue.empty() || _stopping.load(); });
+        }
+        _sleeping.store(false);
+        continue;
+      }
+
+      _pending.fetch_sub(1);
+      ++_unpublished;
+      handle(*r);
+
+      if (_unpublished > 0 && (_unpublished >= _options.publish_interval || _queue.empty())) publish();
+    }
+  }
+
+  // Producers waiting on a dispatch get to see its state, so the state is published before they are told.
+  void handle(request &r) {
+    try {
+      if (r.task) {
+        r.task(_store);
+        return;
+      }
+
+      auto result = _store.dispatch(*r.action);
+      if (r.promise || r.callback) publish();
+      if (r.promise) r.promise->set_value(result);
+      if (r.callback) r.callback(result);
+    } catch (...) {
+      if (r.promise || r.callback) publish();
+      if (r.promise) {
+        r.promise->set_exception(std::current_exception());
+      } else if (_options.on_error) {
+        _options.on_error(std::current_exception());
+      }
+    }
+  }
+
+  void publish() {
+    _published.store(_store.snapshot());
+    _unpublished = 0;
+  }
+
+  basic_store<state_t> _store;
+  concurrent_options _options;
+  atomic_snapshot<state_t> _published;
+  std::size_t _unpublished{0};
+  mpsc_queue<request> _queue;
+  std::atomic<std::size_t> _pending{0};
+  std::atomic<bool> _stopping{false};
+  std::atomic<bool> _sleeping{false};
+  std::mutex _mutex;
+  std::condition_variable _wakeup;
+  std::thread _thread;
+};
+
+}  // namespace flow
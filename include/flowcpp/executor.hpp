@@ -0,0 +1,195 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "mpsc_queue.hpp"
+
+namespace flow {
+
+// Anything that runs tasks somewhere: a thread pool, an event loop, a store's reducer thread.
+using executor_t = std::function<void(std::function<void()>)>;
+
+// Receives the exceptions escaping tasks run on an executor's own threads.
+using error_handler_t = std::function<void(std::exception_ptr)>;
+
+// Fixed set of worker threads sharing one task queue. A task that throws hands its exception to `on_error`, or has it
+// dropped without one, and the worker goes on with the next task.
+class thread_pool {
+ public:
+  explicit thread_pool(std::size_t threads = std::thread::hardware_concurrency(), error_handler_t on_error = {})
+      : _on_error(std::move(on_error)) {
+    threads = std::max<std::size_t>(threads, 1);
+    _workers.reserve(threads);
+    for (std::size_t i = 0; i < threads; ++i) _workers.emplace_back([this] { run(); });
+  }
+
+  thread_pool(const thread_pool &) = delete;
+
+  thread_pool &operator=(const thread_pool &) = delete;
+
+  // Runs every task posted so far, then joins the workers.
+  ~thread_pool() {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _stopping = true;
+    }
+    _wakeup.notify_all();
+    for (auto &worker : _workers) worker.join();
+  }
+
+  void post(std::function<void()> task) {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _tasks.push_back(std::move(task));
+    }
+    _wakeup.notify_one();
+  }
+
+  executor_t executor() {
+    return [this](std::function<void()> task) { post(std::move(task)); };
+  }
+
+ private:
+  void run() {
+    while (true) {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _wakeup.wait(lock, [this] { return _stopping || !_tasks.empty(); });
+        if (_tasks.empty()) return;
+        task = std::move(_tasks.front());
+        _tasks.pop_front();
+      }
+      try {
+        task();
+      } catch (...) {
+        if (_on_error) _on_error(std::current_exception());
+      }
+    }
+  }
+
+  error_handler_t _on_error;
+  std::mutex _mutex;
+  std::condition_variable _wakeup;
+  std::deque<std::function<void()>> _tasks;
+  bool _stopping{false};
+  std::vector<std::thread> _workers;
+};
+
+// Tasks posted from any thread, run by whoever owns the queue when it calls `run_pending`, e.g. the thread of a
+// basic_store once per iteration of its event loop.
+class task_queue {
+ public:
+  void post(std::function<void()> task) { _tasks.push(std::move(task)); }
+
+  executor_t executor() {
+    return [this](std::function<void()> task) { post(std::move(task)); };
+  }
+
+  // Owner thread only. Returns the number of tasks run.
+  std::size_t run_pending() {
+    std::size_t count = 0;
+    while (auto task = _tasks.pop()) {
+      (*task)();
+      ++count;
+    }
+    return count;
+  }
+
+ private:
+  mpsc_queue<std::function<void()>> _tasks;
+};
+
+// One thread running short tasks at their due time, typically handing work over to another executor, so that waiting
+// never holds a worker of that executor. Tasks still waiting when the queue is destroyed are dropped, and a task that
+// throws is reported to `on_error` like on a thread_pool. The queue may be destroyed by one of its own tasks, e.g. when
+// an inline executor runs the last code holding it: the thread then finishes on its own instead of joining itself.
+class timer_queue {
+ public:
+  using clock = std::chrono::steady_clock;
+
+  explicit timer_queue(error_handler_t on_error = {})
+      : _shared(std::make_shared<shared>()), _thread([s = _shared, on_error] { run(*s, on_error); }) {}
+
+  timer_queue(const timer_queue &) = delete;
+
+  timer_queue &operator=(const timer_queue &) = delete;
+
+  ~timer_queue() {
+    {
+      std::lock_guard<std::mutex> lock(_shared->mutex);
+      _shared->stopping = true;
+    }
+    _shared->wakeup.notify_all();
+    if (_thread.get_id() == std::this_thread::get_id()) {
+      _thread.detach();
+    } else {
+      _thread.join();
+    }
+  }
+
+  void post_at(clock::time_point due, std::function<void()> task) {
+    {
+      std::lock_guard<std::mutex> lock(_shared->mutex);
+      _shared->tasks.emplace(due, std::move(task));
+    }
+    _shared->wakeup.notify_all();
+  }
+
+  template <class Rep, class Period>
+  void post_after(std::chrono::duration<Rep, Period> delay, std::function<void()> task) {
+    post_at(clock::now() + std::chrono::duration_cast<clock::duration>(delay), std::move(task));
+  }
+
+ private:
+  // Owned by the thread as well, so that it outlives the queue when the thread is detached.
+  struct shared {
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    std::multimap<clock::time_point, std::function<void()>> tasks;
+    bool stopping{false};
+  };
+
+  static void run(shared &s, const error_handler_t &on_error) {
+    std::unique_lock<std::mutex> lock(s.mutex);
+    while (!s.stopping) {
+      if (s.tasks.empty()) {
+        s.wakeup.wait(lock);
+        continue;
+      }
+      auto next = std::begin(s.tasks);
+      if (next->first > clock::now()) {
+        s.wakeup.wait_until(lock, next->first);
+        continue;
+      }
+
+      auto task = std::move(next->second);
+      s.tasks.erase(next);
+      lock.unlock();
+      try {
+        task();
+      } catch (...) {
+        if (on_error) on_error(std::current_exception());
+      }
+      task = nullptr;  // what it captured may own the queue, whose destructor takes the lock
+      lock.lock();
+    }
+  }
+
+  std::shared_ptr<shared> _shared;
+  std::thread _thread;
+};
+
+}  // namespace flow
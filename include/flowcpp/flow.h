@@ -2,10 +2,29 @@
 
 #include "action.hpp"
 #include "apply_middleware.hpp"
+#include "async_thunk_middleware.hpp"
+#include "atomic_snapshot.hpp"
+#include "combine_reducers.hpp"
 #include "any.hpp"
+#include "concurrent_store.hpp"
 #include "create_store.hpp"
 #include "disposable.hpp"
+#include "executor.hpp"
+#include "instrumentation.hpp"
+#include "journal.hpp"
+#include "latency_histogram.hpp"
 #include "middleware.hpp"
+#include "mpsc_queue.hpp"
+#include "persistent_map.hpp"
+#include "persistent_vector.hpp"
 #include "reselect.hpp"
+#include "selector_graph.hpp"
+#include "small_buffer.hpp"
+#include "state_history.hpp"
+#include "state_snapshots.hpp"
+#include "static_store.hpp"
 #include "store.hpp"
 #include "thunk_middleware.hpp"
+#include "traits.hpp"
+#include "type_id.hpp"
+#include "type_id_map.hpp"
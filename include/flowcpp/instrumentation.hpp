@@ -0,0 +1,245 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "action.hpp"
+#include "latency_histogram.hpp"
+#include "middleware.hpp"
+#include "store.hpp"
+#include "type_id.hpp"
+
+namespace flow {
+
+struct action_metrics {
+  std::string name;
+  latency_summary dispatch;  // the rest of the chain after the instrumentation middleware, subscribers included
+  latency_summary reducer;   // the reducer alone, when it was wrapped with `instrumentation::reducer`
+  latency_summary subscribers;  // the subscribers wrapped with `instrumentation::subscriber` notified of the action
+};
+
+// Per action type counts and latency histograms. `middleware()` (or `static_middleware()`) times each dispatch,
+// `reducer(r)` times the reducer and `subscriber(f)` the subscribers, charged to the action whose dispatch through the
+// middleware notified them; calls outside such a dispatch, like the first one made by `subscribe`, are reported as
+// "none". Action types are told apart by the type the action wraps and get a slot in a fixed-size lock-free table on
+// first sight; types beyond `max_action_types` are counted together as "other". Recording never blocks and `report`
+// may run on any thread. Disabled, each hook costs one relaxed load and a branch.
+class instrumentation {
+ public:
+  explicit instrumentation(std::size_t max_action_types = 256) : _other("other"), _none("none") {
+    std::size_t capacity = 1;
+    while (capacity < 2 * max_action_types) capacity <<= 1;
+    _slots = std::vector<slot>(capacity);
+  }
+
+  instrumentation(const instrumentation &) = delete;
+
+  instrumentation &operator=(const instrumentation &) = delete;
+
+  ~instrumentation() {
+    for (auto &s : _slots) delete s.stats.load();
+  }
+
+  void enable(bool enabled) { _enabled.store(enabled, std::memory_order_relaxed); }
+
+  bool enabled() const { return _enabled.load(std::memory_order_relaxed); }
+
+  // Names `Action` in reports, before it is dispatched. Unnamed types are reported as `action_<n>` in order of first
+  // appearance.
+  template <class Action>
+  void name(std::string name) {
+    auto &stats = stats_for(type_id<Action>());
+    std::lock_guard<std::mutex> lock(_names);
+    stats.name = std::move(name);
+  }
+
+  // For apply_middleware's initializer list.
+  template <class State>
+  auto middleware() {
+    return [this](basic_middleware<State>) {
+      return [this](const dispatch_t &next) {
+        return [this, next](const action &action) -> flow::action {
+          if (!enabled()) return next(action);
+          return timed_dispatch(action, next);
+        };
+      };
+    };
+  }
+
+  // For the variadic apply_middleware.
+  auto static_middleware() {
+    return [this](auto &, const action &action, auto &&next) -> flow::action {
+      if (!enabled()) return next(action);
+      return timed_dispatch(action, next);
+    };
+  }
+
+  template <class State, class Reducer>
+  in_place_reducer_t<State> reducer(Reducer reducer) {
+    auto in_place = to_in_place_reducer<State>(std::move(reducer));
+    return [this, in_place](State &state, const action &action) {
+      if (!enabled()) return in_place(state, action);
+      auto start = clock::now();
+      in_place(state, action);
+      stats_for(action.id()).reducer.record(since(start));
+    };
+  }
+
+  template <class F>
+  auto subscriber(F f) {
+    return [this, f](const auto &... args) mutable {
+      if (!enabled()) return f(args...);
+      auto &charged = current().owner == this ? *current().stats : _none;
+      auto start = clock::now();
+      f(args...);
+      charged.subscribers.record(since(start));
+    };
+  }
+
+  // Metrics of every action type seen so far, the ones taking the most dispatch time in total first.
+  std::vector<action_metrics> report() const {
+    std::vector<const action_stats *> all;
+    for (const auto &s : _slots) {
+      if (auto stats = s.stats.load()) all.push_back(stats);
+    }
+    all.push_back(&_other);
+    all.push_back(&_none);
+
+    std::vector<action_metrics> result;
+    std::lock_guard<std::mutex> lock(_names);
+    for (auto stats : all) {
+      if ((stats == &_other || stats == &_none) && stats->dispatch.count() == 0 && stats->reducer.count() == 0 &&
+          stats->subscribers.count() == 0) {
+        continue;
+      }
+      result.push_back(
+          {stats->name, stats->dispatch.summary(), stats->reducer.summary(), stats->subscribers.summary()});
+    }
+    std::sort(std::begin(result), std::end(result), [](const action_metrics &left, const action_metrics &right) {
+      return left.dispatch.count * left.dispatch.mean > right.dispatch.count * right.dispatch.mean;
+    });
+    return result;
+  }
+
+  // `report` as a text table, latencies in ns.
+  void print(std::ostream &out) const {
+    out << std::left << std::setw(24) << "action" << std::right << std::setw(10) << "count" << std::setw(10)
+        << "mean" << std::setw(10) << "p50" << std::setw(10) << "p99" << std::setw(12) << "max"
+        << std::setw(14) << "reducer p50" << std::setw(14) << "reducer p99" << std::setw(12) << "subs calls"
+        << std::setw(12) << "subs p99" << '\n';
+    for (const auto &m : report()) {
+      out << std::left << std::setw(24) << m.name << std::right << std::setw(10) << m.dispatch.count
+          << std::setw(10) << m.dispatch.mean << std::setw(10) << m.dispatch.p50 << std::setw(10) << m.dispatch.p99
+          << std::setw(12) << m.dispatch.max << std::setw(14) << m.reducer.p50 << std::setw(14) << m.reducer.p99
+          << std::setw(12) << m.subscribers.count << std::setw(12) << m.subscribers.p99 << '\n';
+    }
+  }
+
+  void reset() {
+    for (auto &s : _slots) {
+      if (auto stats = s.stats.load()) stats->reset();
+    }
+    _other.reset();
+    _none.reset();
+  }
+
+ private:
+  using clock = std::chrono::steady_clock;
+
+  struct action_stats {
+    explicit action_stats(std::string name) : name(std::move(name)) {}
+
+    void reset() {
+      dispatch.reset();
+      reducer.reset();
+      subscribers.reset();
+    }
+
+    std::string name;  // guarded by _names once the stats are published
+    latency_histogram dispatch;
+    latency_histogram reducer;
+    latency_histogram subscribers;
+  };
+
+  // The instrumented dispatch running on this thread, which the subscribers it notifies are charged to.
+  struct dispatch_in_progress {
+    const instrumentation *owner;
+    action_stats *stats;
+  };
+
+  static dispatch_in_progress &current() {
+    static thread_local dispatch_in_progress current{nullptr, nullptr};
+    return current;
+  }
+
+  // Makes `stats` the current dispatch's until the scope ends, restoring the outer one after a nested dispatch.
+  struct charge_scope {
+    charge_scope(const instrumentation *owner, action_stats &stats) : _outer(current()) { current() = {owner, &stats}; }
+    ~charge_scope() { current() = _outer; }
+
+    dispatch_in_progress _outer;
+  };
+
+  struct slot {
+    std::atomic<type_id_t> key{nullptr};
+    std::atomic<action_stats *> stats{nullptr};
+  };
+
+  static std::uint64_t since(clock::time_point start) {
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start);
+    return static_cast<std::uint64_t>(elapsed.count());
+  }
+
+  template <class Next>
+  flow::action timed_dispatch(const action &action, Next &next) {
+    auto &stats = stats_for(action.id());
+    charge_scope scope(this, stats);
+    auto start = clock::now();
+    auto result = next(action);
+    stats.dispatch.record(since(start));
+    return result;
+  }
+
+  // Open addressing over the fixed slot table: a new type claims an empty slot with a CAS on its key, then
+  // publishes its stats, which other threads finding the key wait for.
+  action_stats &stats_for(type_id_t id) {
+    auto mask = _slots.size() - 1;
+    auto hash = reinterpret_cast<std::uintptr_t>(id) * UINT64_C(0x9E3779B97F4A7C15);
+    auto i = static_cast<std::size_t>(hash >> 32) & mask;
+    for (std::size_t probes = 0; probes < _slots.size() / 2; ++probes, i = (i + 1) & mask) {
+      auto &s = _slots[i];
+      auto key = s.key.load(std::memory_order_acquire);
+      if (!key && s.key.compare_exchange_strong(key, id)) {
+        s.stats.store(new action_stats("action_" + std::to_string(_types.fetch_add(1))), std::memory_order_release);
+        key = id;
+      }
+      if (key != id) continue;
+
+      while (true) {
+        if (auto stats = s.stats.load(std::memory_order_acquire)) return *stats;
+        std::this_thread::yield();
+      }
+    }
+    return _other;
+  }
+
+  std::atomic<bool> _enabled{true};
+  std::vector<slot> _slots;
+  std::atomic<std::size_t> _types{0};
+  action_stats _other;
+  action_stats _none;
+  mutable std::mutex _names;
+};
+
+}  // namespace flow
@@ -0,0 +1,370 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "action.hpp"
+#include "middleware.hpp"
+#include "store.hpp"
+#include "type_id_map.hpp"
+
+namespace flow {
+
+// Encoders and decoders of the action types worth journaling. Each type is registered under a tag of the user's
+// choosing, which is what the journal stores: unlike type ids, tags are stable across builds and processes.
+class action_codecs {
+ public:
+  using encoder_t = std::function<void(const action &, std::string &)>;
+  using decoder_t = std::function<action(const char *, std::size_t)>;
+
+  // `encode(const Action &, std::string &out)` appends the bytes of an action, `decode(const char *, std::size_t)`
+  // turns them back into an Action.
+  template <class Action, class Encode, class Decode>
+  action_codecs &add(std::uint32_t tag, Encode encode, Decode decode) {
+    _encoders[type_id<Action>()] = {tag, [encode](const action &a, std::string &out) mutable {
+                                      encode(*a.try_as<Action>(), out);
+                                    }};
+    _decoders[tag] = [decode](const char *data, std::size_t size) mutable -> action { return decode(data, size); };
+    return *this;
+  }
+
+  // Byte copy codec for trivially copyable action types.
+  template <class Action>
+  action_codecs &add_trivial(std::uint32_t tag) {
+    static_assert(std::is_trivially_copyable<Action>::value, "add_trivial needs a trivially copyable action type");
+    return add<Action>(
+        tag, [](const Action &a, std::string &out) { out.append(reinterpret_cast<const char *>(&a), sizeof(a)); },
+        [](const char *data, std::size_t size) {
+          Action a;
+          if (size != sizeof(a)) throw std::runtime_error("flow: journal record size does not match its action");
+          std::memcpy(&a, data, sizeof(a));
+          return a;
+        });
+  }
+
+  // Appends the encoded action and sets its tag; false for action types without a codec.
+  bool encode(const action &a, std::string &out, std::uint32_t &tag) const {
+    auto encoder = _encoders.find(a.id());
+    if (!encoder) return false;
+    tag = encoder->tag;
+    encoder->encode(a, out);
+    return true;
+  }
+
+  action decode(std::uint32_t tag, const char *data, std::size_t size) const {
+    auto decoder = _decoders.find(tag);
+    if (decoder == std::end(_decoders)) throw std::runtime_error("flow: journal record with an unknown action tag");
+    return decoder->second(data, size);
+  }
+
+ private:
+  struct encoder {
+    std::uint32_t tag;
+    encoder_t encode;
+  };
+
+  type_id_map<encoder> _encoders;
+  std::unordered_map<std::uint32_t, decoder_t> _decoders;
+};
+
+namespace detail {
+
+// Journal layout: an 8 byte magic, then records of
+// [payload size: u32][tag: u32][payload][checksum of tag and payload: u32], all in native byte order.
+constexpr char journal_magic[8] = {'F', 'L', 'O', 'W', 'J', 'N', 'L', '1'};
+constexpr std::size_t journal_header_size = sizeof(journal_magic);
+constexpr std::size_t journal_record_overhead = 3 * sizeof(std::uint32_t);
+
+inline std::uint32_t fnv1a(const char *data, std::size_t size, std::uint32_t hash = 2166136261u) {
+  for (std::size_t i = 0; i < size; ++i) hash = (hash ^ static_cast<unsigned char>(data[i])) * 16777619u;
+  return hash;
+}
+
+inline std::uint32_t read_u32(const char *p) {
+  std::uint32_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+inline void append_u32(std::string &out, std::uint32_t value) {
+  out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+[[noreturn]] inline void throw_errno(const std::string &what) {
+  throw std::system_error(errno, std::generic_category(), "flow: " + what);
+}
+
+}  // namespace detail
+
+// Read-only view of a journal file, mapped into memory so that replay reads it at close to sequential bandwidth
+// without copying. Records are read up to the first torn or corrupt one, which a crash mid-write can leave behind.
+class journal_reader {
+ public:
+  explicit journal_reader(const std::string &path) {
+    auto fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) detail::throw_errno("cannot open journal " + path);
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+      ::close(fd);
+      detail::throw_errno("cannot stat journal " + path);
+    }
+    _size = static_cast<std::size_t>(st.st_size);
+
+    if (_size > 0) {
+      auto data = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data == MAP_FAILED) {
+        ::close(fd);
+        detail::throw_errno("cannot map journal " + path);
+      }
+      _data = static_cast<const char *>(data);
+      ::madvise(data, _size, MADV_SEQUENTIAL);
+    }
+    ::close(fd);
+
+    if (_size < detail::journal_header_size ||
+        std::memcmp(_data, detail::journal_magic, detail::journal_header_size) != 0) {
+      release();
+      throw std::runtime_error("flow: " + path + " is not a journal");
+    }
+  }
+
+  journal_reader(const journal_reader &) = delete;
+
+  journal_reader &operator=(const journal_reader &) = delete;
+
+  ~journal_reader() { release(); }
+
+  // Calls `f(tag, data, size)` for each intact record starting at byte `offset`, a record boundary such as a value
+  // of `journal::size()`. Returns the offset just past the last intact record.
+  template <class F>
+  std::size_t for_each_record(F f, std::size_t offset = detail::journal_header_size) const {
+    offset = std::max(offset, detail::journal_header_size);
+    while (offset <= _size && _size - offset >= detail::journal_record_overhead) {
+      auto size = detail::read_u32(_data + offset);
+      if (_size - offset - detail::journal_record_overhead < size) break;
+
+      auto tagged = _data + offset + sizeof(std::uint32_t);
+      auto tagged_size = sizeof(std::uint32_t) + size;
+      if (detail::read_u32(tagged + tagged_size) != detail::fnv1a(tagged, tagged_size)) break;
+
+      f(detail::read_u32(tagged), tagged + sizeof(std::uint32_t), static_cast<std::size_t>(size));
+      offset += detail::journal_record_overhead + size;
+    }
+    return offset;
+  }
+
+  // Decodes each intact record from `offset` and calls `f(const action &)`. Returns the offset past the last one.
+  template <class F>
+  std::size_t for_each(const action_codecs &codecs, F f, std::size_t offset = detail::journal_header_size) const {
+    return for_each_record(
+        [&](std::uint32_t tag, const char *data, std::size_t size) { f(codecs.decode(tag, data, size)); }, offset);
+  }
+
+  std::size_t file_size() const { return _size; }
+
+ private:
+  void release() {
+    if (_data) ::munmap(const_cast<char *>(_data), _size);
+    _data = nullptr;
+  }
+
+  const char *_data{nullptr};
+  std::size_t _size{0};
+};
+
+// Rebuilds a state from a journal by running its actions through `store.replay`, the store's reducer and routes,
+// without middleware or subscribers; the store's own state is left alone. Returns the offset past the last replayed
+// record.
+template <class State>
+std::size_t replay_journal(const std::string &path, const action_codecs &codecs, const basic_store<State> &store,
+                           State &state, std::size_t offset = detail::journal_header_size) {
+  return journal_reader(path).for_each(codecs, [&](const action &a) { store.replay(state, a); }, offset);
+}
+
+struct journal_options {
+  std::size_t group_records{64};    // records written and synced together, 1 to sync every action
+  std::size_t group_bytes{1 << 16};  // a group is also committed once it holds this many bytes
+  bool sync{true};                   // fdatasync each group; without it durability is left to the OS
+};
+
+// Append-only action log. The journal middleware appends every action with a codec once the rest of the chain has
+// reduced it: actions a reducer rejects by throwing and actions the store drops are not logged, so replay never sees
+// them. It belongs last in the chain, next to the reducer. Records are buffered and committed by groups with one
+// write and one fdatasync, so a crash loses at most the current group. `flush` commits early, e.g. when the
+// application goes idle. Opening an existing journal drops a torn record left at its end. Single writer; nobody else
+// may append to the file.
+class journal {
+ public:
+  journal(const std::string &path, action_codecs codecs, journal_options options = {})
+      : _codecs(std::move(codecs)), _options(options) {
+    auto valid = std::size_t{0};
+    struct stat st;
+    if (::stat(path.c_str(), &st) == 0 && st.st_size > 0) {
+      valid = journal_reader(path).for_each_record([](std::uint32_t, const char *, std::size_t) {});
+    }
+
+    _fd = ::open(path.c_str(), O_WRONLY | O_CREAT, 0644);
+    if (_fd < 0) detail::throw_errno("cannot open journal " + path);
+    if (valid == 0) _pending.append(detail::journal_magic, detail::journal_header_size);
+    if (::ftruncate(_fd, static_cast<off_t>(valid)) != 0 || ::lseek(_fd, static_cast<off_t>(valid), SEEK_SET) < 0) {
+      ::close(_fd);
+      detail::throw_errno("cannot truncate journal " + path);
+    }
+    _committed = valid;
+    if (valid == 0) flush();
+  }
+
+  journal(const journal &) = delete;
+
+  journal &operator=(const journal &) = delete;
+
+  ~journal() {
+    try {
+      flush();
+    } catch (...) {
+    }
+    ::close(_fd);
+  }
+
+  // Returns false for action types without a codec, which are not journaled.
+  bool append(const action &a) {
+    auto start = _pending.size();
+    _pending.resize(start + 2 * sizeof(std::uint32_t));
+
+    std::uint32_t tag;
+    auto encoded = false;
+    try {
+      encoded = _codecs.encode(a, _pending, tag);
+    } catch (...) {
+      _pending.resize(start);
+      throw;
+    }
+    if (!encoded) {
+      _pending.resize(start);
+      return false;
+    }
+
+    auto size = static_cast<std::uint32_t>(_pending.size() - start - 2 * sizeof(std::uint32_t));
+    std::memcpy(&_pending[start], &size, sizeof(size));
+    std::memcpy(&_pending[start + sizeof(size)], &tag, sizeof(tag));
+    detail::append_u32(_pending, detail::fnv1a(&_pending[start + sizeof(size)], sizeof(tag) + size));
+
+    if (++_pending_records >= _options.group_records || _pending.size() >= _options.group_bytes) commit();
+    return true;
+  }
+
+  // Writes and syncs the pending group. From a subscriber, this includes the action being dispatched.
+  void flush() {
+    append_reduced();
+    commit();
+  }
+
+  // Offset the next record will be written at, for replaying only what comes after it.
+  std::size_t size() const { return _committed + _pending.size(); }
+
+  // Bytes known to be on disk.
+  std::size_t committed() const { return _committed; }
+
+  // For apply_middleware's initializer list.
+  template <class State>
+  auto middleware() {
+    return [this](basic_middleware<State> middleware) {
+      return [this, middleware](const dispatch_t &next) {
+        return [this, middleware, next](const action &action) -> flow::action {
+          if (middleware.reducing()) return next(action);
+          return record(action, next, middleware);
+        };
+      };
+    };
+  }
+
+  // For the variadic apply_middleware.
+  auto static_middleware() {
+    return [this](auto &store, const action &action, auto &&next) -> flow::action {
+      if (store.reducing()) return next(action);
+      return record(action, next, store);
+    };
+  }
+
+ private:
+  // Appends `a` once `next` has reduced it. An action dispatched by a subscriber reaches the journal while the one it
+  // reacts to is still inside `next`; that one is reduced by then and is appended first, so records keep the order
+  // actions were reduced in. When `next` throws, `a` is left out only if nothing was reduced, i.e. the reducer rejected
+  // it; an exception from a subscriber comes after `a` was reduced.
+  template <class Next, class Store>
+  action record(const action &a, Next &next, const Store &store) {
+    append_reduced();
+    _unrecorded.push_back(&a);
+    auto reduced = store.reduced();
+    try {
+      auto result = next(a);
+      append_reduced();
+      return result;
+    } catch (...) {
+      if (store.reduced() != reduced) {
+        append_reduced();
+      } else if (!_unrecorded.empty() && _unrecorded.back() == &a) {
+        _unrecorded.pop_back();
+      }
+      throw;
+    }
+  }
+
+  void append_reduced() {
+    try {
+      for (auto a : _unrecorded) append(*a);
+    } catch (...) {
+      _unrecorded.clear();
+      throw;
+    }
+    _unrecorded.clear();
+  }
+
+  void commit() {
+    std::size_t written = 0;
+    while (written < _pending.size()) {
+      auto n = ::write(_fd, _pending.data() + written, _pending.size() - written);
+      if (n < 0 && errno == EINTR) continue;
+      if (n < 0) {
+        auto error = errno;
+        _committed += written;
+        _pending.erase(0, written);
+        errno = error;
+        detail::throw_errno("cannot write journal");
+      }
+      written += static_cast<std::size_t>(n);
+    }
+
+    // the group is in the file now whether or not the sync succeeds, and must not be written again
+    _committed += written;
+    _pending.clear();
+    _pending_records = 0;
+    if (written > 0 && _options.sync && ::fdatasync(_fd) != 0) detail::throw_errno("cannot sync journal");
+  }
+
+  action_codecs _codecs;
+  journal_options _options;
+  int _fd{-1};
+  std::string _pending;
+  std::size_t _pending_records{0};
+  std::size_t _committed{0};
+  std::vector<const action *> _unrecorded;
+};
+
+}  // namespace flow
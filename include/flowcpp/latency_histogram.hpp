@@ -0,0 +1,124 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace flow {
+
+struct latency_summary {
+  std::uint64_t count{0};
+  std::uint64_t mean{0};
+  std::uint64_t p50{0};
+  std::uint64_t p90{0};
+  std::uint64_t p99{0};
+  std::uint64_t max{0};
+};
+
+// HDR-style histogram of durations in nanoseconds. Every power of two range is split into 16 linear buckets, so a
+// recorded value is known within 1/16 of itself from 1 ns up to about a minute (larger values land in the last
+// bucket). Recording is two relaxed atomic increments and a load, and never blocks; reading from another thread gives
+// a consistent enough picture for monitoring.
+class latency_histogram {
+ public:
+  static constexpr unsigned sub_bucket_bits = 4;
+  static constexpr unsigned max_magnitude = 36;
+  static constexpr std::size_t bucket_count = (max_magnitude - sub_bucket_bits + 2) << sub_bucket_bits;
+
+  void record(std::uint64_t ns) {
+    _buckets[index_of(ns)].fetch_add(1, std::memory_order_relaxed);
+    _sum.fetch_add(ns, std::memory_order_relaxed);
+
+    auto max = _max.load(std::memory_order_relaxed);
+    while (ns > max && !_max.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {
+    }
+  }
+
+  // Summed over the buckets, keeping `record` down to two atomic increments.
+  std::uint64_t count() const {
+    std::uint64_t total = 0;
+    for (const auto &bucket : _buckets) total += bucket.load(std::memory_order_relaxed);
+    return total;
+  }
+
+  std::uint64_t sum() const { return _sum.load(std::memory_order_relaxed); }
+
+  std::uint64_t max() const { return _max.load(std::memory_order_relaxed); }
+
+  // Value at or below which a `fraction` of the recorded values fall, e.g. 0.99 for p99, rounded up to its bucket.
+  std::uint64_t percentile(double fraction) const {
+    auto total = count();
+    if (total == 0) return 0;
+
+    auto rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(fraction * total + 0.5));
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < bucket_count; ++i) {
+      seen += _buckets[i].load(std::memory_order_relaxed);
+      if (seen >= rank) return std::min(upper_bound(i) - 1, max());
+    }
+    return max();
+  }
+
+  latency_summary summary() const {
+    auto n = count();
+    return {n, n ? sum() / n : 0, percentile(0.5), percentile(0.9), percentile(0.99), max()};
+  }
+
+  // Calls `f(lower, upper, count)` for every non-empty bucket holding values in [lower, upper).
+  template <class F>
+  void for_each_bucket(F f) const {
+    for (std::size_t i = 0; i < bucket_count; ++i) {
+      auto n = _buckets[i].load(std::memory_order_relaxed);
+      if (n) f(lower_bound(i), upper_bound(i), n);
+    }
+  }
+
+  void reset() {
+    for (auto &bucket : _buckets) bucket.store(0, std::memory_order_relaxed);
+    _sum.store(0, std::memory_order_relaxed);
+    _max.store(0, std::memory_order_relaxed);
+  }
+
+ private:
+  static constexpr std::uint64_t sub_buckets = std::uint64_t{1} << sub_bucket_bits;
+
+  // Values below 16 have a bucket each; above, the top 5 bits of the value select the bucket within its magnitude.
+  static std::size_t index_of(std::uint64_t ns) {
+    if (ns < sub_buckets) return static_cast<std::size_t>(ns);
+
+    auto magnitude = magnitude_of(ns);
+    if (magnitude > max_magnitude) return bucket_count - 1;
+    auto top = ns >> (magnitude - sub_bucket_bits);
+    return static_cast<std::size_t>(((magnitude - sub_bucket_bits + 1) << sub_bucket_bits) + (top - sub_buckets));
+  }
+
+  static unsigned magnitude_of(std::uint64_t ns) {
+#if defined(__GNUC__)
+    return 63 - __builtin_clzll(ns);
+#else
+    unsigned magnitude = 0;
+    while (ns >>= 1) ++magnitude;
+    return magnitude;
+#endif
+  }
+
+  static std::uint64_t lower_bound(std::size_t index) {
+    if (index < sub_buckets) return index;
+    auto magnitude = (index >> sub_bucket_bits) + sub_bucket_bits - 1;
+    return (sub_buckets + (index & (sub_buckets - 1))) << (magnitude - sub_bucket_bits);
+  }
+
+  static std::uint64_t upper_bound(std::size_t index) {
+    if (index < sub_buckets) return index + 1;
+    auto magnitude = (index >> sub_bucket_bits) + sub_bucket_bits - 1;
+    return (sub_buckets + (index & (sub_buckets - 1)) + 1) << (magnitude - sub_bucket_bits);
+  }
+
+  std::array<std::atomic<std::uint64_t>, bucket_count> _buckets{};
+  std::atomic<std::uint64_t> _sum{0};
+  std::atomic<std::uint64_t> _max{0};
+};
+
+}  // namespace flow
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "action.hpp"
 #include "common.h"
 
 namespace flow {
@@ -25,11 +26,17 @@ class basic_middleware {
 
   basic_middleware& operator=(basic_middleware&&) = default;
 
-  std::function<action_t(action_t)> dispatch() const { return _p->dispatch(); }
+  dispatch_t dispatch() const { return _p->dispatch(); }
 
-  std::function<state_t()> get_state() const { return _p->get_state(); }
+  get_state_t<state_t> get_state() const { return _p->get_state(); }
 
-  state_t state() const { return _p->get_state()(); }
+  const state_t &state() const { return _p->get_state()(); }
+
+  batch_t batch() const { return _p->batch(); }
+
+  bool reducing() const { return _p->reducing(); }
+
+  std::size_t reduced() const { return _p->reduced(); }
 
  private:
   struct concept {
@@ -40,6 +47,12 @@ class basic_middleware {
     virtual dispatch_t dispatch() const = 0;
 
     virtual get_state_t<state_t> get_state() const = 0;
+
+    virtual batch_t batch() const = 0;
+
+    virtual bool reducing() const = 0;
+
+    virtual std::size_t reduced() const = 0;
   };
 
   template <class T>
@@ -52,6 +65,43 @@ class basic_middleware {
 
     get_state_t<state_t> get_state() const override { return _t.get_state(); }
 
+    batch_t batch() const override { return batch(_t, detail::priority<1>{}); }
+
+    template <class U>
+    static auto batch(const U &u, detail::priority<1>) -> decltype(batch_t(u.batch())) {
+      return u.batch();
+    }
+
+    // middleware without batching support runs the callable as is
+    template <class U>
+    static batch_t batch(const U &, detail::priority<0>) {
+      return [](const std::function<void()> &f) { f(); };
+    }
+
+    bool reducing() const override { return reducing(_t, detail::priority<1>{}); }
+
+    template <class U>
+    static auto reducing(const U &u, detail::priority<1>) -> decltype(bool(u.reducing())) {
+      return u.reducing();
+    }
+
+    template <class U>
+    static bool reducing(const U &, detail::priority<0>) {
+      return false;
+    }
+
+    std::size_t reduced() const override { return reduced(_t, detail::priority<1>{}); }
+
+    template <class U>
+    static auto reduced(const U &u, detail::priority<1>) -> decltype(std::size_t(u.reduced())) {
+      return u.reduced();
+    }
+
+    template <class U>
+    static std::size_t reduced(const U &, detail::priority<0>) {
+      return 0;
+    }
+
     T _t;
   };
 
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <experimental/optional>
+#include <utility>
+
+namespace flow {
+
+// Unbounded lock-free multi-producer single-consumer queue (Vyukov's intrusive node queue). `push` is wait-free and
+// may be called from any thread; `pop` and `empty` must only be called from the single consumer thread.
+template <class T>
+class mpsc_queue {
+ public:
+  mpsc_queue() : _head(new node), _tail(_head.load(std::memory_order_relaxed)) {}
+
+  mpsc_queue(const mpsc_queue &) = delete;
+
+  mpsc_queue &operator=(const mpsc_queue &) = delete;
+
+  ~mpsc_queue() {
+    while (pop()) {
+    }
+    delete _tail;
+  }
+
+  void push(T value) {
+    auto n = new node;
+    n->value.emplace(std::move(value));
+    auto previous = _head.exchange(n, std::memory_order_acq_rel);
+    previous->next.store(n, std::memory_order_seq_cst);
+  }
+
+  std::experimental::optional<T> pop() {
+    auto next = _tail->next.load(std::memory_order_acquire);
+    if (!next) return {};
+
+    // `next` becomes the new stub node once its value has been taken out
+    std::experimental::optional<T> value(std::move(*next->value));
+    next->value = std::experimental::nullopt;
+    delete _tail;
+    _tail = next;
+    return value;
+  }
+
+  // A push that has swapped the head but not yet linked its node still reads as empty.
+  bool empty() const { return _tail->next.load(std::memory_order_seq_cst) == nullptr; }
+
+ private:
+  struct node {
+    std::atomic<node *> next{nullptr};
+    std::experimental::optional<T> value;
+  };
+
+  std::atomic<node *> _head;
+  node *_tail;
+};
+
+}  // namespace flow
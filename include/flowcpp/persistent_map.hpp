@@ -0,0 +1,324 @@
+#pragma once
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace flow {
+
+// Immutable hash map for use as a state member: a hash array mapped trie (CHAMP layout) consuming 5 bits of the hash
+// per level. Updates copy only the nodes on the path to the key, O(log32 n), and share everything else with the
+// previous version, which stays valid for any subscriber or selector still holding it.
+template <class Key, class Value, class Hash = std::hash<Key>, class KeyEqual = std::equal_to<Key>>
+class persistent_map {
+  static constexpr std::size_t bits = 5;
+  static constexpr std::size_t mask = (std::size_t{1} << bits) - 1;
+  static constexpr std::size_t hash_bits = sizeof(std::size_t) * CHAR_BIT;
+
+ public:
+  using key_type = Key;
+  using mapped_type = Value;
+  using value_type = std::pair<Key, Value>;
+  using size_type = std::size_t;
+
+ private:
+  struct node;
+  using node_ptr = std::shared_ptr<const node>;
+
+  // Entries stored directly in the node are flagged in `datamap`, sub-nodes in `nodemap`, both indexed by the 5 hash
+  // bits of the node's level. Once the hash is exhausted a node only holds colliding entries, without bitmaps.
+  struct node {
+    std::uint32_t datamap{0};
+    std::uint32_t nodemap{0};
+    std::vector<value_type> entries;
+    std::vector<node_ptr> children;
+  };
+
+ public:
+  class const_iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = persistent_map::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const value_type *;
+    using reference = const value_type &;
+
+    const_iterator() = default;
+
+    reference operator*() const { return *_current; }
+
+    pointer operator->() const { return _current; }
+
+    const_iterator &operator++() {
+      advance();
+      return *this;
+    }
+
+    const_iterator operator++(int) {
+      auto copy = *this;
+      advance();
+      return copy;
+    }
+
+    bool operator==(const const_iterator &other) const { return _current == other._current; }
+
+    bool operator!=(const const_iterator &other) const { return _current != other._current; }
+
+   private:
+    friend class persistent_map;
+
+    struct frame {
+      const node *n;
+      std::size_t entry;
+      std::size_t child;
+    };
+
+    explicit const_iterator(const node *root) {
+      _stack.push_back({root, 0, 0});
+      advance();
+    }
+
+    void advance() {
+      while (!_stack.empty()) {
+        auto &top = _stack.back();
+        if (top.entry < top.n->entries.size()) {
+          _current = &top.n->entries[top.entry++];
+          return;
+        }
+        if (top.child < top.n->children.size()) {
+          auto child = top.n->children[top.child++].get();
+          _stack.push_back({child, 0, 0});
+          continue;
+        }
+        _stack.pop_back();
+      }
+      _current = nullptr;
+    }
+
+    std::vector<frame> _stack;
+    const value_type *_current{nullptr};
+  };
+
+  persistent_map() : _root(std::make_shared<node>()) {}
+
+  persistent_map(std::initializer_list<value_type> values) : persistent_map() {
+    for (const auto &value : values) *this = set(value.first, value.second);
+  }
+
+  size_type size() const { return _size; }
+
+  bool empty() const { return _size == 0; }
+
+  const Value *find(const Key &key) const {
+    auto n = _root.get();
+    auto hash = Hash()(key);
+    for (std::size_t shift = 0;; shift += bits) {
+      if (shift >= hash_bits) {
+        for (const auto &entry : n->entries) {
+          if (KeyEqual()(entry.first, key)) return &entry.second;
+        }
+        return nullptr;
+      }
+
+      auto bit = bit_for(hash, shift);
+      if (n->datamap & bit) {
+        const auto &entry = n->entries[index_of(n->datamap, bit)];
+        return KeyEqual()(entry.first, key) ? &entry.second : nullptr;
+      }
+      if (!(n->nodemap & bit)) return nullptr;
+      n = n->children[index_of(n->nodemap, bit)].get();
+    }
+  }
+
+  size_type count(const Key &key) const { return find(key) ? 1 : 0; }
+
+  const Value &at(const Key &key) const {
+    auto value = find(key);
+    if (!value) throw std::out_of_range("persistent_map::at");
+    return *value;
+  }
+
+  const_iterator begin() const { return const_iterator(_root.get()); }
+
+  const_iterator end() const { return const_iterator(); }
+
+  persistent_map set(Key key, Value value) const {
+    auto result = *this;
+    auto added = false;
+    auto hash = Hash()(key);
+    result._root = assoc(_root, hash, 0, std::move(key), std::move(value), added);
+    if (added) ++result._size;
+    return result;
+  }
+
+  persistent_map erase(const Key &key) const {
+    auto removed = false;
+    auto root = dissoc(_root, Hash()(key), 0, key, removed);
+    if (!removed) return *this;
+
+    auto result = *this;
+    result._root = std::move(root);
+    --result._size;
+    return result;
+  }
+
+  // Whether both maps are the same version, i.e. share all their storage.
+  bool identical(const persistent_map &other) const { return _root == other._root; }
+
+  bool operator==(const persistent_map &other) const {
+    if (identical(other)) return true;
+    if (_size != other._size) return false;
+    for (const auto &entry : *this) {
+      auto value = other.find(entry.first);
+      if (!value || !(*value == entry.second)) return false;
+    }
+    return true;
+  }
+
+  bool operator!=(const persistent_map &other) const { return !(*this == other); }
+
+ private:
+  static std::uint32_t bit_for(std::size_t hash, std::size_t shift) {
+    return std::uint32_t{1} << ((hash >> shift) & mask);
+  }
+
+  static std::size_t popcount(std::uint32_t x) {
+    x = x - ((x >> 1) & 0x55555555u);
+    x = (x & 0x33333333u) + ((x >> 2) & 0x33333333u);
+    return (((x + (x >> 4)) & 0x0f0f0f0fu) * 0x01010101u) >> 24;
+  }
+
+  static std::size_t index_of(std::uint32_t bitmap, std::uint32_t bit) { return popcount(bitmap & (bit - 1)); }
+
+  static node_ptr assoc(const node_ptr &current, std::size_t hash, std::size_t shift, Key key, Value value,
+                        bool &added) {
+    auto n = std::make_shared<node>(*current);
+
+    if (shift >= hash_bits) {
+      for (auto &entry : n->entries) {
+        if (KeyEqual()(entry.first, key)) {
+          entry.second = std::move(value);
+          return n;
+        }
+      }
+      n->entries.emplace_back(std::move(key), std::move(value));
+      added = true;
+      return n;
+    }
+
+    auto bit = bit_for(hash, shift);
+    if (current->datamap & bit) {
+      auto index = index_of(current->datamap, bit);
+      auto &entry = n->entries[index];
+      if (KeyEqual()(entry.first, key)) {
+        entry.second = std::move(value);
+        return n;
+      }
+
+      // two keys share this slot: push both one level down
+      auto entry_hash = Hash()(entry.first);
+      auto child =
+          merge(std::move(entry), entry_hash, value_type(std::move(key), std::move(value)), hash, shift + bits);
+      n->entries.erase(n->entries.begin() + index);
+      n->datamap &= ~bit;
+      n->children.insert(n->children.begin() + index_of(n->nodemap, bit), std::move(child));
+      n->nodemap |= bit;
+      added = true;
+    } else if (current->nodemap & bit) {
+      auto index = index_of(current->nodemap, bit);
+      n->children[index] = assoc(current->children[index], hash, shift + bits, std::move(key), std::move(value), added);
+    } else {
+      n->entries.insert(n->entries.begin() + index_of(n->datamap, bit), value_type(std::move(key), std::move(value)));
+      n->datamap |= bit;
+      added = true;
+    }
+    return n;
+  }
+
+  static node_ptr merge(value_type first, std::size_t first_hash, value_type second, std::size_t second_hash,
+                        std::size_t shift) {
+    auto n = std::make_shared<node>();
+
+    if (shift >= hash_bits) {
+      n->entries.push_back(std::move(first));
+      n->entries.push_back(std::move(second));
+      return n;
+    }
+
+    auto first_bit = bit_for(first_hash, shift);
+    auto second_bit = bit_for(second_hash, shift);
+    if (first_bit == second_bit) {
+      n->nodemap = first_bit;
+      n->children.push_back(merge(std::move(first), first_hash, std::move(second), second_hash, shift + bits));
+    } else {
+      n->datamap = first_bit | second_bit;
+      if (first_bit < second_bit) {
+        n->entries.push_back(std::move(first));
+        n->entries.push_back(std::move(second));
+      } else {
+        n->entries.push_back(std::move(second));
+        n->entries.push_back(std::move(first));
+      }
+    }
+    return n;
+  }
+
+  static node_ptr dissoc(const node_ptr &current, std::size_t hash, std::size_t shift, const Key &key,
+                         bool &removed) {
+    if (shift >= hash_bits) {
+      for (std::size_t i = 0; i < current->entries.size(); ++i) {
+        if (KeyEqual()(current->entries[i].first, key)) {
+          auto n = std::make_shared<node>(*current);
+          n->entries.erase(n->entries.begin() + i);
+          removed = true;
+          return n;
+        }
+      }
+      return current;
+    }
+
+    auto bit = bit_for(hash, shift);
+    if (current->datamap & bit) {
+      auto index = index_of(current->datamap, bit);
+      if (!KeyEqual()(current->entries[index].first, key)) return current;
+
+      auto n = std::make_shared<node>(*current);
+      n->entries.erase(n->entries.begin() + index);
+      n->datamap &= ~bit;
+      removed = true;
+      return n;
+    }
+
+    if (!(current->nodemap & bit)) return current;
+
+    auto index = index_of(current->nodemap, bit);
+    auto child = dissoc(current->children[index], hash, shift + bits, key, removed);
+    if (!removed) return current;
+
+    auto n = std::make_shared<node>(*current);
+    if (child->children.empty() && child->entries.size() <= 1) {
+      // keep the trie canonical: a sub-node left with a single entry is pulled back into this node
+      n->children.erase(n->children.begin() + index);
+      n->nodemap &= ~bit;
+      if (!child->entries.empty()) {
+        n->entries.insert(n->entries.begin() + index_of(n->datamap, bit), child->entries.front());
+        n->datamap |= bit;
+      }
+    } else {
+      n->children[index] = std::move(child);
+    }
+    return n;
+  }
+
+  size_type _size{0};
+  node_ptr _root;
+};
+
+}  // namespace flow
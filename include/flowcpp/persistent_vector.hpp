@@ -0,0 +1,257 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace flow {
+
+// Immutable vector for use as a state member. Elements live in 32-wide chunks at the leaves of a trie, with the last
+// chunk kept aside as a tail; every update copies only the path to the touched chunk (O(log32 n)) and shares the
+// rest with the previous version, which stays valid for any subscriber or selector still holding it.
+template <class T>
+class persistent_vector {
+  static constexpr std::size_t bits = 5;
+  static constexpr std::size_t branches = std::size_t{1} << bits;
+  static constexpr std::size_t mask = branches - 1;
+
+  struct node;
+  using node_ptr = std::shared_ptr<const node>;
+
+  struct node {
+    std::array<node_ptr, branches> children;
+    std::vector<T> values;
+  };
+
+ public:
+  using value_type = T;
+  using size_type = std::size_t;
+
+  class const_iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const T *;
+    using reference = const T &;
+
+    const_iterator() = default;
+
+    reference operator*() const { return _leaf[_index & mask]; }
+
+    pointer operator->() const { return &_leaf[_index & mask]; }
+
+    const_iterator &operator++() {
+      ++_index;
+      if ((_index & mask) == 0 && _index < _vector->size()) _leaf = _vector->leaf_for(_index);
+      return *this;
+    }
+
+    const_iterator operator++(int) {
+      auto copy = *this;
+      ++*this;
+      return copy;
+    }
+
+    bool operator==(const const_iterator &other) const { return _index == other._index; }
+
+    bool operator!=(const const_iterator &other) const { return _index != other._index; }
+
+   private:
+    friend class persistent_vector;
+
+    const_iterator(const persistent_vector *vector, size_type index)
+        : _vector(vector), _index(index), _leaf(index < vector->size() ? vector->leaf_for(index) : nullptr) {}
+
+    const persistent_vector *_vector{nullptr};
+    size_type _index{0};
+    const T *_leaf{nullptr};
+  };
+
+  persistent_vector() : _root(std::make_shared<node>()), _tail(std::make_shared<node>()) {}
+
+  persistent_vector(std::initializer_list<T> values) : persistent_vector() {
+    for (const auto &value : values) *this = push_back(value);
+  }
+
+  size_type size() const { return _size; }
+
+  bool empty() const { return _size == 0; }
+
+  const T &operator[](size_type index) const { return leaf_for(index)[index & mask]; }
+
+  const T &at(size_type index) const {
+    if (index >= _size) throw std::out_of_range("persistent_vector::at");
+    return (*this)[index];
+  }
+
+  const T &front() const { return (*this)[0]; }
+
+  const T &back() const { return (*this)[_size - 1]; }
+
+  const_iterator begin() const { return const_iterator(this, 0); }
+
+  const_iterator end() const { return const_iterator(this, _size); }
+
+  persistent_vector push_back(T value) const {
+    auto result = *this;
+
+    if (_size - tail_offset() < branches) {
+      auto tail = std::make_shared<node>(*_tail);
+      tail->values.push_back(std::move(value));
+      result._tail = std::move(tail);
+      ++result._size;
+      return result;
+    }
+
+    // the tail is full: move it into the trie, growing a new root level when the trie itself is full
+    if ((_size >> bits) > (std::size_t{1} << _shift)) {
+      auto root = std::make_shared<node>();
+      root->children[0] = _root;
+      root->children[1] = new_path(_shift, _tail);
+      result._root = std::move(root);
+      result._shift += bits;
+    } else {
+      result._root = push_tail(_shift, _root, _tail);
+    }
+
+    auto tail = std::make_shared<node>();
+    tail->values.reserve(branches);
+    tail->values.push_back(std::move(value));
+    result._tail = std::move(tail);
+    ++result._size;
+    return result;
+  }
+
+  persistent_vector set(size_type index, T value) const {
+    if (index >= _size) throw std::out_of_range("persistent_vector::set");
+
+    auto result = *this;
+    if (index >= tail_offset()) {
+      auto tail = std::make_shared<node>(*_tail);
+      tail->values[index & mask] = std::move(value);
+      result._tail = std::move(tail);
+    } else {
+      result._root = assoc(_shift, _root, index, std::move(value));
+    }
+    return result;
+  }
+
+  persistent_vector pop_back() const {
+    if (_size == 0) throw std::out_of_range("persistent_vector::pop_back");
+    if (_size == 1) return persistent_vector();
+
+    auto result = *this;
+    --result._size;
+
+    if (_size - tail_offset() > 1) {
+      auto tail = std::make_shared<node>(*_tail);
+      tail->values.pop_back();
+      result._tail = std::move(tail);
+      return result;
+    }
+
+    // the tail becomes empty: take the last chunk of the trie as the new tail
+    result._tail = leaf_node_for(_size - 2);
+    auto root = pop_tail(_shift, _root);
+    if (!root) root = std::make_shared<node>();
+    if (_shift > bits && !root->children[1]) {
+      result._root = root->children[0];
+      result._shift -= bits;
+    } else {
+      result._root = std::move(root);
+    }
+    return result;
+  }
+
+  // Whether both vectors are the same version, i.e. share all their storage.
+  bool identical(const persistent_vector &other) const {
+    return _root == other._root && _tail == other._tail && _size == other._size;
+  }
+
+  bool operator==(const persistent_vector &other) const {
+    if (identical(other)) return true;
+    if (_size != other._size) return false;
+    return std::equal(begin(), end(), other.begin());
+  }
+
+  bool operator!=(const persistent_vector &other) const { return !(*this == other); }
+
+ private:
+  size_type tail_offset() const { return _size < branches ? 0 : ((_size - 1) >> bits) << bits; }
+
+  const node *leaf_node_ptr(size_type index) const {
+    if (index >= tail_offset()) return _tail.get();
+    auto n = _root.get();
+    for (auto level = _shift; level > 0; level -= bits) n = n->children[(index >> level) & mask].get();
+    return n;
+  }
+
+  node_ptr leaf_node_for(size_type index) const {
+    if (index >= tail_offset()) return _tail;
+    auto n = _root;
+    for (auto level = _shift; level > 0; level -= bits) n = n->children[(index >> level) & mask];
+    return n;
+  }
+
+  const T *leaf_for(size_type index) const { return leaf_node_ptr(index)->values.data(); }
+
+  static node_ptr new_path(std::size_t level, node_ptr leaf) {
+    if (level == 0) return leaf;
+    auto n = std::make_shared<node>();
+    n->children[0] = new_path(level - bits, std::move(leaf));
+    return n;
+  }
+
+  node_ptr push_tail(std::size_t level, const node_ptr &parent, node_ptr tail) const {
+    auto n = std::make_shared<node>(*parent);
+    auto index = ((_size - 1) >> level) & mask;
+    if (level == bits) {
+      n->children[index] = std::move(tail);
+    } else if (auto child = parent->children[index]) {
+      n->children[index] = push_tail(level - bits, child, std::move(tail));
+    } else {
+      n->children[index] = new_path(level - bits, std::move(tail));
+    }
+    return n;
+  }
+
+  static node_ptr assoc(std::size_t level, const node_ptr &current, size_type index, T value) {
+    auto n = std::make_shared<node>(*current);
+    if (level == 0) {
+      n->values[index & mask] = std::move(value);
+    } else {
+      auto child = (index >> level) & mask;
+      n->children[child] = assoc(level - bits, current->children[child], index, std::move(value));
+    }
+    return n;
+  }
+
+  node_ptr pop_tail(std::size_t level, const node_ptr &current) const {
+    auto index = ((_size - 2) >> level) & mask;
+    if (level > bits) {
+      auto child = pop_tail(level - bits, current->children[index]);
+      if (!child && index == 0) return nullptr;
+      auto n = std::make_shared<node>(*current);
+      n->children[index] = std::move(child);
+      return n;
+    }
+    if (index == 0) return nullptr;
+    auto n = std::make_shared<node>(*current);
+    n->children[index] = nullptr;
+    return n;
+  }
+
+  size_type _size{0};
+  std::size_t _shift{bits};
+  node_ptr _root;
+  node_ptr _tail;
+};
+
+}  // namespace flow
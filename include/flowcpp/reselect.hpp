@@ -1,5 +1,15 @@
 #pragma once
 
+#include <experimental/optional>
+#include <functional>
+#include <list>
+#include <memory>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+
+#include "traits.hpp"
+
 // #define RESELECT_DEBUG
 
 namespace flow{
@@ -34,7 +44,7 @@ namespace flow{
 
 	template <std::size_t I = 0, typename FuncT, typename... Tp, typename... Sp, typename... Xp>
 	inline typename std::enable_if<I == sizeof...(Tp), void>::type
-	  for_each_in_tuple(std::tuple<Tp...> &, std::tuple<Sp...>& s, std::tuple<Xp...>& x, FuncT) // Unused arguments are given no names.
+	  for_each_in_tuple(std::tuple<Tp...> &, std::tuple<Sp...>&, std::tuple<Xp...>&, FuncT) // Unused arguments are given no names.
 	  { }
 
 	template <std::size_t I = 0, typename FuncT, typename... Tp, typename... Sp, typename... Xp>
@@ -95,6 +105,184 @@ namespace flow{
 	};
 
 
+	// Hash memoize
+	// Caches on the argument tuple itself: keys are hashed with one hasher per argument (std::hash by default) and
+	// verified with operator==, so a hit is a single lookup that allocates nothing.
+	template <std::size_t ...I, typename Hashers, typename Tuple>
+	std::size_t hash_tuple_impl(Hashers const & hashers, Tuple const & tuple, std::index_sequence<I...>){
+	  auto seed = std::size_t{0};
+	  int dummy[] = { (seed ^= std::get<I>(hashers)(std::get<I>(tuple)) + 0x9e3779b9 + (seed << 6) + (seed >> 2), 0)..., 0 };
+	  static_cast<void>(dummy);
+	  return seed;
+	}
+
+	template <typename Hashers>
+	struct tuple_hasher {
+	  template <typename Tuple>
+	  std::size_t operator()(Tuple const & tuple) const {
+	    return hash_tuple_impl(hashers, tuple, std::make_index_sequence<std::tuple_size<Tuple>::value>());
+	  }
+
+	  Hashers hashers;
+	};
+
+	template <typename... Args>
+	auto make_hashers(){ return std::tuple<std::hash<Args>...>(); }
+
+	template <typename... Args, typename Hashers>
+	auto make_hashers(Hashers hashers){ return hashers; }
+
+	template <typename T, typename... Args>
+	auto hash_memoize = [](auto... hashers){
+	  using hashers_t = decltype(make_hashers<Args...>(hashers...));
+	  auto hasher = tuple_hasher<hashers_t>{make_hashers<Args...>(hashers...)};
+
+	  return [=](result_func<T, Args...> func) -> memoize_func<T, Args...>{
+	    auto result_map = std::unordered_map<std::tuple<Args...>, T, tuple_hasher<hashers_t>>(0, hasher);
+	    return [=](std::tuple<Args...> args) mutable -> T{
+
+	      auto cached = result_map.find(args);
+	      if (cached != result_map.end()){
+					#ifdef RESELECT_DEBUG
+	        std::cout << "use cache" << "\n";
+					#endif
+	        return cached->second;
+	      }
+
+	      auto new_result = func(args);
+	      result_map.emplace(std::move(args), new_result);
+	      return new_result;
+	    };
+	  };
+	};
+
+
+	// LRU memoize
+	// Like hash_memoize, but bounded: the least recently used result is evicted once the cache holds more than
+	// `max_entries` results or more than `max_bytes` as measured by `entry_size` (0 disables a limit). Hits and
+	// evictions are O(1). The cache is shared by every copy of the memoized function.
+	struct memoize_stats {
+	  std::size_t hits = 0;
+	  std::size_t misses = 0;
+	  std::size_t evictions = 0;
+	};
+
+	template <typename T, typename... Args>
+	struct lru_options {
+	  std::size_t max_entries = 0;
+	  std::size_t max_bytes = 0;
+	  std::function<std::size_t(std::tuple<Args...> const &, T const &)> entry_size =
+	    [](std::tuple<Args...> const &, T const &){ return sizeof(std::tuple<Args...>) + sizeof(T); };
+	  std::shared_ptr<memoize_stats> stats = std::make_shared<memoize_stats>();
+	};
+
+	template <typename T, typename... Args>
+	auto lru_memoize = [](lru_options<T, Args...> options, auto... hashers){
+	  using hashers_t = decltype(make_hashers<Args...>(hashers...));
+	  using key_t = std::tuple<Args...>;
+	  using entry_t = std::pair<key_t, T>;
+
+	  struct key_ref_hasher {
+	    std::size_t operator()(std::reference_wrapper<key_t const> key) const { return hasher(key.get()); }
+	    tuple_hasher<hashers_t> hasher;
+	  };
+
+	  struct key_ref_equal {
+	    bool operator()(std::reference_wrapper<key_t const> left, std::reference_wrapper<key_t const> right) const {
+	      return left.get() == right.get();
+	    }
+	  };
+
+	  // Entries are kept most recently used first; the index refers to the keys stored in the list nodes.
+	  struct cache {
+	    std::list<entry_t> entries;
+	    std::unordered_map<std::reference_wrapper<key_t const>, typename std::list<entry_t>::iterator, key_ref_hasher,
+	                       key_ref_equal> index;
+	    std::size_t bytes = 0;
+	  };
+
+	  auto hasher = key_ref_hasher{tuple_hasher<hashers_t>{make_hashers<Args...>(hashers...)}};
+
+	  return [=](result_func<T, Args...> func) -> memoize_func<T, Args...>{
+	    auto shared_cache = std::make_shared<cache>();
+	    shared_cache->index = decltype(shared_cache->index)(0, hasher);
+
+	    return [=](std::tuple<Args...> args) -> T{
+	      auto &c = *shared_cache;
+	      auto &stats = *options.stats;
+
+	      auto cached = c.index.find(std::cref(args));
+	      if (cached != c.index.end()){
+					#ifdef RESELECT_DEBUG
+	        std::cout << "use cache" << "\n";
+					#endif
+	        ++stats.hits;
+	        c.entries.splice(c.entries.begin(), c.entries, cached->second);
+	        return cached->second->second;
+	      }
+
+	      ++stats.misses;
+	      auto new_result = func(args);
+	      c.bytes += options.entry_size(args, new_result);
+	      c.entries.emplace_front(std::move(args), new_result);
+	      c.index.emplace(std::cref(c.entries.front().first), c.entries.begin());
+
+	      auto over_budget = [&]{
+	        return (options.max_entries && c.entries.size() > options.max_entries) ||
+	               (options.max_bytes && c.bytes > options.max_bytes);
+	      };
+	      while (c.entries.size() > 1 && over_budget()){
+	        auto &last = c.entries.back();
+	        c.bytes -= options.entry_size(last.first, last.second);
+	        c.index.erase(std::cref(last.first));
+	        c.entries.pop_back();
+	        ++stats.evictions;
+	      }
+	      return new_result;
+	    };
+	  };
+	};
+
+
+	// Identity memoize
+	// Compares arguments with `same_value` instead of a std::function per argument. Arguments are moved into the cache
+	// and the result is returned by const reference, valid until the next recomputation.
+	template <std::size_t ...I, typename Tuple>
+	bool same_values_impl(Tuple const & left, Tuple const & right, std::index_sequence<I...>){
+	  auto same = true;
+	  int dummy[] = { (same = same && same_value(std::get<I>(left), std::get<I>(right), detail::priority<2>()), 0)..., 0 };
+	  static_cast<void>(dummy);
+	  return same;
+	}
+
+	template <typename T, typename... Args>
+	struct identity_cache {
+	  std::experimental::optional<std::tuple<Args...>> last_args;
+	  std::experimental::optional<T> last_result;
+	};
+
+	template <typename T, typename... Args>
+	auto identity_memoize = [](){
+	  return [](auto func){
+	    auto cache = std::make_shared<identity_cache<T, Args...>>();
+
+	    return [func, cache](std::tuple<Args...> args) -> T const &{
+	      auto &last = *cache;
+	      if (last.last_args && same_values_impl(args, *last.last_args, std::index_sequence_for<Args...>())){
+					#ifdef RESELECT_DEBUG
+	        std::cout << "use cache" << "\n";
+					#endif
+	        return *last.last_result;
+	      }
+
+	      last.last_result = func(args);
+	      last.last_args = std::move(args);
+	      return *last.last_result;
+	    };
+	  };
+	};
+
+
 	// Default memoize
 	template <typename T>
 	using equality_check = std::function<bool(T, T)>;
@@ -145,17 +333,17 @@ namespace flow{
 	  copy_params_result_impl( params, selectors, state, index_sequence);
 	}
 
-	auto create_selector_creator = [](auto memoized_result_func){
+	static auto create_selector_creator = [](auto memoized_result_func){
 	  return [=](auto selectors, auto func){
-	    return [=](auto state){
+	    return [=](auto const & state) -> decltype(auto){
 	    	tuple_function_ret<decltype(selectors)> params;
         copy_params_result(params, selectors, state);
-        return memoized_result_func(params);
+        return memoized_result_func(std::move(params));
 	    };
 	  };
 	};
 
-	auto create_selector = [](auto selectors, auto func, auto memoize){
+	static auto create_selector = [](auto selectors, auto func, auto memoize){
 	#ifdef RESELECT_DEBUG
 	  auto memoized_result_func = memoize(
 	    [func = func](auto args){
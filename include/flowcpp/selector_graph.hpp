@@ -0,0 +1,169 @@
+#pragma once
+
+#include <experimental/optional>
+#include <functional>
+#include <memory>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "disposable.hpp"
+#include "reselect.hpp"
+#include "store.hpp"
+
+namespace flow {
+
+// Registry of selectors over a basic_store that knows their dependency graph. Sources project the state, derived
+// selectors combine other selectors; after each dispatch every source is re-evaluated once, and a derived selector is
+// recomputed only when one of its inputs changed (compared with `same_value`). Subscribers of a selector are called
+// when its value changes, after the whole graph is up to date.
+template <class State>
+class selector_graph {
+  struct concept {
+    virtual ~concept() = default;
+
+    // Whether the value changed.
+    virtual bool update(const State &state, std::size_t round) = 0;
+
+    virtual void notify() = 0;
+
+    std::size_t changed_round{0};
+  };
+
+  template <class T>
+  struct value_node : concept {
+    bool set(T next, std::size_t round) {
+      if (value && same_value(*value, next, detail::priority<2>())) return false;
+      value = std::move(next);
+      this->changed_round = round;
+      return true;
+    }
+
+    void notify() override {
+      for (const auto &pair : subscribers) pair.second(*value);
+    }
+
+    std::experimental::optional<T> value;
+    int next_id{0};
+    std::unordered_map<int, std::function<void(const T &)>> subscribers;
+  };
+
+  template <class T, class F>
+  struct source_node : value_node<T> {
+    explicit source_node(F f) : f(std::move(f)) {}
+
+    bool update(const State &state, std::size_t round) override { return this->set(f(state), round); }
+
+    F f;
+  };
+
+  template <class T, class F, class... Deps>
+  struct derived_node : value_node<T> {
+    derived_node(F f, value_node<Deps> *... deps) : f(std::move(f)), deps(deps...) {}
+
+    bool update(const State &, std::size_t round) override {
+      return update(round, std::index_sequence_for<Deps...>());
+    }
+
+    template <std::size_t... I>
+    bool update(std::size_t round, std::index_sequence<I...>) {
+      auto dirty = !this->value;
+      int dummy[] = {(dirty = dirty || std::get<I>(deps)->changed_round == round, 0)..., 0};
+      static_cast<void>(dummy);
+      return dirty && this->set(f(*std::get<I>(deps)->value...), round);
+    }
+
+    F f;
+    std::tuple<value_node<Deps> *...> deps;
+  };
+
+ public:
+  using state_t = State;
+
+  template <class T>
+  class handle {
+   public:
+    const T &value() const { return *_node->value; }
+
+   private:
+    friend class selector_graph;
+
+    explicit handle(value_node<T> *node) : _node(node) {}
+
+    value_node<T> *_node;
+  };
+
+  explicit selector_graph(basic_store<state_t> &store) : _store(store) {
+    _subscription.emplace(store.subscribe([this](const state_t &state) { update(state); }));
+  }
+
+  selector_graph(const selector_graph &) = delete;
+
+  selector_graph &operator=(const selector_graph &) = delete;
+
+  ~selector_graph() { _subscription->dispose(); }
+
+  // `f(const State &)` projecting the state, re-evaluated after every dispatch.
+  template <class T, class F>
+  handle<T> source(F f) {
+    return add(std::make_unique<source_node<T, F>>(std::move(f)));
+  }
+
+  // `f(const Deps &...)` over other selectors of this graph, recomputed only when one of them changes.
+  template <class T, class F, class... Deps>
+  handle<T> derive(F f, handle<Deps>... deps) {
+    return add(std::make_unique<derived_node<T, F, Deps...>>(std::move(f), deps._node...));
+  }
+
+  // `subscriber(const T &)` is called with the current value, then whenever it changes.
+  template <class T, class F>
+  basic_disposable<> subscribe(handle<T> selector, F subscriber) {
+    auto node = selector._node;
+    subscriber(*node->value);
+    auto id = node->next_id++;
+    node->subscribers[id] = std::move(subscriber);
+
+    return basic_disposable<>{
+        disposable_holder{[node, id]() { return node->subscribers.find(id) == std::end(node->subscribers); },
+                          [node, id]() { node->subscribers.erase(id); }}};
+  }
+
+  // Selectors whose value changed in the last update.
+  std::size_t last_changed() const { return _changed.size(); }
+
+ private:
+  template <class Node>
+  auto add(std::unique_ptr<Node> node) {
+    node->update(_store.state(), _round);
+    auto result = handle<typename decltype(node->value)::value_type>(node.get());
+    _nodes.push_back(std::move(node));
+    return result;
+  }
+
+  // Nodes are kept in insertion order, which is a topological order since inputs must exist before their users.
+  void update(const state_t &state) {
+    ++_round;
+    _changed.clear();
+    for (const auto &node : _nodes) {
+      if (node->update(state, _round)) _changed.push_back(node.get());
+    }
+    for (auto node : _changed) node->notify();
+  }
+
+  struct disposable_holder {
+    basic_disposable<>::disposed_t disposed() const { return _disposed; }
+    basic_disposable<>::disposable_t disposable() const { return _disposer; }
+
+    basic_disposable<>::disposed_t _disposed;
+    basic_disposable<>::disposable_t _disposer;
+  };
+
+  basic_store<state_t> &_store;
+  std::vector<std::unique_ptr<concept>> _nodes;
+  std::vector<concept *> _changed;
+  std::size_t _round{1};
+  std::experimental::optional<basic_disposable<>> _subscription;
+};
+
+}  // namespace flow
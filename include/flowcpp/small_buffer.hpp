@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace flow {
+
+// Owning pointer to a type-erased `Concept` which keeps small implementations in an inline buffer and only falls
+// back to the heap when they do not fit. `Concept` must declare
+//   virtual void copy_to(small_buffer &) const;
+//   virtual void move_to(small_buffer &) noexcept;
+// which implementations forward to `emplace<concrete>(...)`.
+template <class Concept, std::size_t Capacity>
+class small_buffer {
+ public:
+  static constexpr std::size_t capacity = Capacity;
+
+  template <class T>
+  using fits_inline = std::integral_constant<bool, sizeof(T) <= Capacity && alignof(T) <= alignof(void *) &&
+                                                       std::is_nothrow_move_constructible<T>::value>;
+
+  small_buffer() = default;
+
+  small_buffer(const small_buffer &other) {
+    if (other._p) other._p->copy_to(*this);
+  }
+
+  small_buffer(small_buffer &&other) noexcept { steal(other); }
+
+  small_buffer &operator=(const small_buffer &other) {
+    if (this != &other) {
+      small_buffer copy(other);
+      reset();
+      steal(copy);
+    }
+    return *this;
+  }
+
+  small_buffer &operator=(small_buffer &&other) noexcept {
+    if (this != &other) {
+      reset();
+      steal(other);
+    }
+    return *this;
+  }
+
+  ~small_buffer() { reset(); }
+
+  // Strong guarantee: the new value is built before the current one is destroyed, so `args` may refer into it and a
+  // throwing constructor leaves it untouched.
+  template <class T, class... Args>
+  T *emplace(Args &&... args) {
+    if (_p) {
+      small_buffer replacement;
+      replacement.template emplace<T>(std::forward<Args>(args)...);
+      *this = std::move(replacement);
+      return static_cast<T *>(_p);
+    }
+    auto p = construct<T>(fits_inline<T>{}, std::forward<Args>(args)...);
+    _p = p;
+    return p;
+  }
+
+  void reset() noexcept {
+    if (!_p) return;
+    if (is_inline()) {
+      _p->~Concept();
+    } else {
+      delete _p;
+    }
+    _p = nullptr;
+  }
+
+  bool is_inline() const {
+    auto p = reinterpret_cast<const unsigned char *>(_p);
+    auto buffer = reinterpret_cast<const unsigned char *>(&_buffer);
+    return p >= buffer && p < buffer + sizeof(_buffer);
+  }
+
+  Concept *get() const { return _p; }
+
+  Concept *operator->() const { return _p; }
+
+  explicit operator bool() const { return _p != nullptr; }
+
+ private:
+  template <class T, class... Args>
+  T *construct(std::true_type, Args &&... args) {
+    return ::new (static_cast<void *>(&_buffer)) T(std::forward<Args>(args)...);
+  }
+
+  template <class T, class... Args>
+  T *construct(std::false_type, Args &&... args) {
+    return new T(std::forward<Args>(args)...);
+  }
+
+  void steal(small_buffer &other) noexcept {
+    if (!other._p) return;
+    if (other.is_inline()) {
+      other._p->move_to(*this);
+      other.reset();
+    } else {
+      _p = other._p;
+      other._p = nullptr;
+    }
+  }
+
+  Concept *_p{nullptr};
+  typename std::aligned_storage<(Capacity > 0 ? Capacity : 1), alignof(void *)>::type _buffer;
+};
+
+}  // namespace flow
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "action.hpp"
+#include "middleware.hpp"
+#include "store.hpp"
+
+namespace flow {
+
+template <class State>
+struct history_options {
+  std::size_t max_bytes{16 << 20};   // memory the recorded actions and keyframes may use
+  std::size_t keyframe_interval{64};  // actions between two keyframes, the most a reconstruction replays
+  std::function<std::size_t(const State &)> state_size = [](const State &) { return sizeof(State); };
+  std::function<std::size_t(const action &)> action_size = [](const action &) { return sizeof(action); };
+};
+
+// Time travel over a store's past states without a copy of the state per action. The history middleware records the
+// reduced actions in the order they were reduced and, every `keyframe_interval` actions, a keyframe copy of the
+// state; any past state is rebuilt from the closest earlier keyframe by replaying at most that many actions through
+// the store's reducer and routes. Once the actions and keyframes outgrow `max_bytes` the oldest keyframe and the
+// actions up to the next one are dropped.
+// States built from persistent containers share most of their storage between keyframes.
+//
+// Positions count the actions recorded since the history was created: position n is the state after the n-th
+// action. After jumping back, the next recorded action discards the positions after the current one.
+template <class State>
+class state_history {
+ public:
+  using state_t = State;
+
+  explicit state_history(history_options<state_t> options = {}) : _options(std::move(options)) {
+    if (_options.keyframe_interval == 0) _options.keyframe_interval = 1;
+  }
+
+  // For apply_middleware's initializer list. Belongs last in the chain, next to the reducer.
+  auto middleware() {
+    return [this](basic_middleware<state_t> middleware) {
+      return [this, middleware](const dispatch_t &next) {
+        return [this, middleware, next](const action &action) -> flow::action {
+          if (middleware.reducing()) return next(action);
+          return record(action, next, middleware);
+        };
+      };
+    };
+  }
+
+  // For the variadic apply_middleware.
+  auto static_middleware() {
+    return [this](auto &store, const action &action, auto &&next) -> flow::action {
+      if (store.reducing()) return next(action);
+      return record(action, next, store);
+    };
+  }
+
+  bool empty() const { return _keyframes.empty(); }
+
+  // Oldest position still reachable.
+  std::size_t first() const { return _keyframes.empty() ? 0 : _keyframes.front().position; }
+
+  std::size_t last() const { return first() + _actions.size(); }
+
+  // Position of the store's state: `last()` unless the store was sent back in time.
+  std::size_t current() const { return _current; }
+
+  std::size_t bytes() const { return _bytes; }
+
+  // The action that led to `position`, for first() < position <= last().
+  const action &action_at(std::size_t position) const {
+    check(position);
+    if (position == first()) throw std::out_of_range("state_history::action_at");
+    return _actions[position - first() - 1];
+  }
+
+  // Rebuilds the state at `position` with `store.replay`; `store` is the store the history records.
+  state_t state_at(const basic_store<state_t> &store, std::size_t position) const {
+    check(position);
+
+    auto keyframe = std::upper_bound(std::begin(_keyframes), std::end(_keyframes), position,
+                                     [](std::size_t p, const frame &f) { return p < f.position; });
+    --keyframe;
+
+    auto state = *keyframe->state;
+    for (auto p = keyframe->position; p < position; ++p) store.replay(state, _actions[p - first()]);
+    return state;
+  }
+
+  // Sets the store's state to the one at `position`; the subscribers are notified, nothing is recorded.
+  void jump_to(basic_store<state_t> &store, std::size_t position) {
+    store.replace_state(state_at(store, position));
+    _current = position;
+  }
+
+  bool step_back(basic_store<state_t> &store) {
+    if (empty() || _current == first()) return false;
+    jump_to(store, _current - 1);
+    return true;
+  }
+
+  bool step_forward(basic_store<state_t> &store) {
+    if (empty() || _current == last()) return false;
+    jump_to(store, _current + 1);
+    return true;
+  }
+
+ private:
+  struct frame {
+    std::size_t position;
+    std::shared_ptr<const state_t> state;
+  };
+
+  void check(std::size_t position) const {
+    if (empty() || position < first() || position > last()) throw std::out_of_range("state_history: no such position");
+  }
+
+  // Records `a` once `next` has reduced it, in reduction order like the journal: an action dispatched by a subscriber
+  // arrives while the one it reacts to is still inside `next`, reduced by then, which is recorded first. Actions the
+  // reducer rejects are left out.
+  template <class Next, class Store>
+  action record(const action &a, Next &next, const Store &store) {
+    record_reduced(store.state());
+    before(store.state());
+    _unrecorded.push_back(&a);
+    auto reduced = store.reduced();
+    try {
+      auto result = next(a);
+      record_reduced(store.state());
+      return result;
+    } catch (...) {
+      if (store.reduced() != reduced) {
+        record_reduced(store.state());
+      } else if (!_unrecorded.empty() && _unrecorded.back() == &a) {
+        _unrecorded.pop_back();
+      }
+      throw;
+    }
+  }
+
+  // Each record call clears the list before adding its action, so it holds at most one, which left `state`.
+  void record_reduced(const state_t &state) {
+    for (auto a : _unrecorded) after(*a, state);
+    _unrecorded.clear();
+  }
+
+  void before(const state_t &state) {
+    if (_keyframes.empty()) {
+      add_keyframe(0, state);
+      return;
+    }
+    if (_current < last()) discard_after(_current);
+  }
+
+  void after(const action &action, const state_t &state) {
+    _actions.push_back(action);
+    _bytes += _options.action_size(action);
+    _current = last();
+
+    if (_current - _keyframes.back().position >= _options.keyframe_interval) add_keyframe(_current, state);
+    while (_bytes > _options.max_bytes && _keyframes.size() > 1) drop_oldest();
+  }
+
+  void add_keyframe(std::size_t position, const state_t &state) {
+    _keyframes.push_back({position, std::make_shared<const state_t>(state)});
+    _bytes += _options.state_size(state);
+  }
+
+  void drop_oldest() {
+    auto next = _keyframes[1].position;
+    for (auto p = first(); p < next; ++p) {
+      _bytes -= _options.action_size(_actions.front());
+      _actions.pop_front();
+    }
+    _bytes -= _options.state_size(*_keyframes.front().state);
+    _keyframes.pop_front();
+  }
+
+  void discard_after(std::size_t position) {
+    while (last() > position) {
+      _bytes -= _options.action_size(_actions.back());
+      _actions.pop_back();
+    }
+    while (_keyframes.back().position > position) {
+      _bytes -= _options.state_size(*_keyframes.back().state);
+      _keyframes.pop_back();
+    }
+  }
+
+  history_options<state_t> _options;
+  std::deque<action> _actions;
+  std::deque<frame> _keyframes;
+  std::size_t _current{0};
+  std::size_t _bytes{0};
+  std::vector<const action *> _unrecorded;
+};
+
+}  // namespace flow
@@ -0,0 +1,290 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <experimental/optional>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "disposable.hpp"
+#include "journal.hpp"
+#include "store.hpp"
+
+namespace flow {
+
+template <class State>
+struct state_codec {
+  std::function<void(const State &, std::string &)> encode;  // appends the bytes of a state
+  std::function<State(const char *, std::size_t)> decode;
+};
+
+struct snapshot_options {
+  std::size_t every{10000};                          // notifications between two snapshots
+  bool sync{true};                                   // fsync the snapshot before it replaces the previous one
+  std::function<void(std::exception_ptr)> on_error;  // failures of the background writer
+};
+
+namespace detail {
+
+// Snapshot layout: an 8 byte magic, the journal offset the state corresponds to (u64), the payload size (u64), the
+// payload, and a checksum of the payload (u32), all in native byte order.
+constexpr char snapshot_magic[8] = {'F', 'L', 'O', 'W', 'S', 'N', 'P', '1'};
+
+inline void write_file(const std::string &path, const std::string &contents, bool sync) {
+  auto fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) throw_errno("cannot create " + path);
+
+  std::size_t written = 0;
+  while (written < contents.size()) {
+    auto n = ::write(fd, contents.data() + written, contents.size() - written);
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0) {
+      auto error = errno;
+      ::close(fd);
+      errno = error;
+      throw_errno("cannot write " + path);
+    }
+    written += static_cast<std::size_t>(n);
+  }
+  if (sync && ::fsync(fd) != 0) {
+    auto error = errno;
+    ::close(fd);
+    errno = error;
+    throw_errno("cannot sync " + path);
+  }
+  ::close(fd);
+}
+
+// Makes a rename in the directory of `path` durable.
+inline void sync_directory_of(const std::string &path) {
+  auto slash = path.find_last_of('/');
+  auto directory = slash == std::string::npos ? std::string(".") : path.substr(0, slash + 1);
+  auto fd = ::open(directory.c_str(), O_RDONLY);
+  if (fd < 0) return;
+  ::fsync(fd);
+  ::close(fd);
+}
+
+}  // namespace detail
+
+// Periodic snapshots of a store's state, so that startup only replays the end of the journal. Every `every`
+// notifications the latest shared snapshot of the state is handed to a background thread together with the journal
+// offset it corresponds to, and encoded and written there: the dispatch thread pays for committing the journal group
+// and, through copy on write, for one state copy on the next dispatch. A snapshot requested while another is being
+// written replaces it if it has not started yet. Files are replaced atomically, so `path` always holds a complete
+// snapshot. The journal's middleware must be in the store's chain. Declare the journal before the store and the
+// snapshots after it: the journal must outlive the store, and the snapshots unsubscribe from it when destroyed.
+template <class State>
+class state_snapshots {
+ public:
+  using state_t = State;
+
+  state_snapshots(std::string path, state_codec<state_t> codec, journal &journal, snapshot_options options = {})
+      : _path(std::move(path)),
+        _codec(std::move(codec)),
+        _journal(journal),
+        _options(std::move(options)),
+        _thread([this] { run(); }) {}
+
+  state_snapshots(const state_snapshots &) = delete;
+
+  state_snapshots &operator=(const state_snapshots &) = delete;
+
+  // Writes the snapshot still pending, if any.
+  ~state_snapshots() {
+    if (_subscription) _subscription->dispose();
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _stopping = true;
+    }
+    _wakeup.notify_all();
+    _thread.join();
+  }
+
+  // Takes a snapshot every `options.every` notifications of `store`.
+  void attach(const basic_store<state_t> &store) {
+    _subscription.emplace(store.subscribe_snapshot([this](std::shared_ptr<const state_t> state) {
+      if (_has_finished.load(std::memory_order_relaxed)) release_finished();
+      if (++_notifications < _options.every) return;
+      _notifications = 0;
+      take(std::move(state));
+    }));
+  }
+
+  // Snapshots `state`, which must be the store's current state, from the dispatch thread, e.g. from a subscriber.
+  void take(std::shared_ptr<const state_t> state) {
+    if (_has_finished.load(std::memory_order_relaxed)) release_finished();
+
+    // the journal logs actions once they are reduced: flushing appends the one `state` was just notified for, so the
+    // journal's size is then the offset of the first action not yet in `state`
+    _journal.flush();
+    auto offset = _journal.size();
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _pending.emplace(request{std::move(state), offset});
+    }
+    _wakeup.notify_all();
+  }
+
+  // Blocks until every requested snapshot has been written.
+  void wait() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _idle.wait(lock, [this] { return !_pending && !_writing; });
+  }
+
+  std::size_t written() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _written;
+  }
+
+ private:
+  struct request {
+    std::shared_ptr<const state_t> state;
+    std::size_t offset;
+  };
+
+  void run() {
+    while (true) {
+      request r;
+      {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _wakeup.wait(lock, [this] { return _pending || _stopping; });
+        if (!_pending) return;
+        r = std::move(*_pending);
+        _pending = std::experimental::nullopt;
+        _writing = true;
+      }
+
+      try {
+        write(r);
+      } catch (...) {
+        if (_options.on_error) _options.on_error(std::current_exception());
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _finished = std::move(r.state);
+        _has_finished.store(true, std::memory_order_relaxed);
+        _writing = false;
+      }
+      _idle.notify_all();
+    }
+  }
+
+  // The store decides to copy its state by its use count alone, which orders nothing: the state a snapshot was written
+  // from is only released on the dispatch thread, after taking the lock the writer released it under.
+  void release_finished() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _finished.reset();
+    _has_finished.store(false, std::memory_order_relaxed);
+  }
+
+  void write(const request &r) {
+    std::string contents(detail::snapshot_magic, sizeof(detail::snapshot_magic));
+    contents.resize(contents.size() + 2 * sizeof(std::uint64_t));
+    auto payload_start = contents.size();
+    _codec.encode(*r.state, contents);
+
+    std::uint64_t offset = r.offset;
+    std::uint64_t size = contents.size() - payload_start;
+    std::memcpy(&contents[sizeof(detail::snapshot_magic)], &offset, sizeof(offset));
+    std::memcpy(&contents[sizeof(detail::snapshot_magic) + sizeof(offset)], &size, sizeof(size));
+    detail::append_u32(contents, detail::fnv1a(contents.data() + payload_start, size));
+
+    auto temporary = _path + ".tmp";
+    detail::write_file(temporary, contents, _options.sync);
+    if (std::rename(temporary.c_str(), _path.c_str()) != 0) detail::throw_errno("cannot replace " + _path);
+    if (_options.sync) detail::sync_directory_of(_path);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    ++_written;
+  }
+
+  std::string _path;
+  state_codec<state_t> _codec;
+  journal &_journal;
+  snapshot_options _options;
+  std::size_t _notifications{0};
+  std::experimental::optional<basic_disposable<>> _subscription;
+
+  mutable std::mutex _mutex;
+  std::condition_variable _wakeup;
+  std::condition_variable _idle;
+  std::experimental::optional<request> _pending;
+  std::shared_ptr<const state_t> _finished;
+  std::atomic<bool> _has_finished{false};
+  bool _writing{false};
+  bool _stopping{false};
+  std::size_t _written{0};
+  std::thread _thread;
+};
+
+// Rebuilds the state at startup from the snapshot at `snapshot_path`, when there is one, and the journal records
+// written after it; without a snapshot the whole journal is replayed onto `initial_state`. Records are replayed with
+// `store.replay`, so the store's routes must be registered first; the store's own state is left alone.
+template <class State>
+State restore_state(const std::string &snapshot_path, const state_codec<State> &codec, const std::string &journal_path,
+                    const action_codecs &codecs, const basic_store<State> &store, State initial_state) {
+  std::size_t offset = detail::journal_header_size;
+  auto state = std::move(initial_state);
+
+  struct stat st;
+  if (::stat(snapshot_path.c_str(), &st) == 0) {
+    auto fd = ::open(snapshot_path.c_str(), O_RDONLY);
+    if (fd < 0) detail::throw_errno("cannot open " + snapshot_path);
+    auto size = static_cast<std::size_t>(st.st_size);
+    auto data = size ? ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if (data == MAP_FAILED) throw std::runtime_error("flow: cannot map snapshot " + snapshot_path);
+
+    std::unique_ptr<void, std::function<void(void *)>> mapping(data, [size](void *p) { ::munmap(p, size); });
+    auto bytes = static_cast<const char *>(data);
+    auto header = sizeof(detail::snapshot_magic) + 2 * sizeof(std::uint64_t);
+
+    std::uint64_t snapshot_offset = 0;
+    std::uint64_t payload_size = 0;
+    if (size >= header) {
+      std::memcpy(&snapshot_offset, bytes + sizeof(detail::snapshot_magic), sizeof(snapshot_offset));
+      std::memcpy(&payload_size, bytes + sizeof(detail::snapshot_magic) + sizeof(snapshot_offset),
+                  sizeof(payload_size));
+    }
+    if (size < header || std::memcmp(bytes, detail::snapshot_magic, sizeof(detail::snapshot_magic)) != 0 ||
+        size - header < sizeof(std::uint32_t) || payload_size != size - header - sizeof(std::uint32_t) ||
+        detail::read_u32(bytes + header + payload_size) != detail::fnv1a(bytes + header, payload_size)) {
+      throw std::runtime_error("flow: " + snapshot_path + " is not a valid snapshot");
+    }
+
+    state = codec.decode(bytes + header, static_cast<std::size_t>(payload_size));
+    offset = static_cast<std::size_t>(snapshot_offset);
+  }
+
+  if (::stat(journal_path.c_str(), &st) != 0) {
+    if (offset > detail::journal_header_size) {
+      throw std::runtime_error("flow: journal " + journal_path + " is missing the actions before the snapshot");
+    }
+    return state;
+  }
+
+  journal_reader reader(journal_path);
+  if (offset > reader.file_size()) {
+    throw std::runtime_error("flow: journal " + journal_path + " is older than snapshot " + snapshot_path);
+  }
+  reader.for_each(codecs, [&](const action &a) { store.replay(state, a); }, offset);
+  return state;
+}
+
+}  // namespace flow
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+#if __cplusplus >= 201703L
+#include <variant>
+#endif
+
+#include "action.hpp"
+#include "common.h"
+#include "disposable.hpp"
+#include "traits.hpp"
+
+namespace flow {
+
+// Closed set of action types accepted by a basic_static_store.
+template <class... Actions>
+struct action_set {
+  template <class Action>
+  static constexpr bool contains() {
+    bool matches[] = {false, std::is_same<Action, Actions>::value...};
+    for (auto match : matches) {
+      if (match) return true;
+    }
+    return false;
+  }
+};
+
+// Store whose action set, reducer and middleware are all known at compile time. Nothing is type-erased: the
+// reducer is invoked as `reducer(State, const Action &)` with the concrete action type (taking `State &&` instead
+// saves copying the state), and each middleware as `middleware(store, const Action &, next)` where `next` forwards
+// to the following middleware or the reducer, so a dispatch can be inlined end to end.
+template <class State, class ActionSet, class Reducer, class... Middlewares>
+class basic_static_store {
+ public:
+  using state_t = State;
+  using action_set_t = ActionSet;
+
+  basic_static_store(Reducer reducer, state_t initial_state, Middlewares... middlewares)
+      : _reducer(std::move(reducer)),
+        _middlewares(std::move(middlewares)...),
+        _current_state(std::move(initial_state)),
+        _subscribers(std::make_shared<subscribers_t>()) {}
+
+  template <class Action>
+  void dispatch(const Action &action) {
+    static_assert(action_set_t::template contains<Action>(), "action is not part of the store's action set");
+    dispatch_from<0>(action);
+  }
+
+#if __cplusplus >= 201703L
+  template <class... Actions>
+  void dispatch(const std::variant<Actions...> &action) {
+    std::visit([this](const auto &a) { dispatch(a); }, action);
+  }
+#endif
+
+  basic_disposable<> subscribe(state_subscribe_t<state_t> subscriber) {
+    subscriber(_current_state);
+    auto id = _next_id++;
+    (*_subscribers)[id] = std::move(subscriber);
+
+    std::weak_ptr<subscribers_t> subscribers = _subscribers;
+    return basic_disposable<>{disposable_holder{[subscribers, id]() {
+                                                  auto s = subscribers.lock();
+                                                  return !s || s->find(id) == std::end(*s);
+                                                },
+                                                [subscribers, id]() {
+                                                  if (auto s = subscribers.lock()) s->erase(id);
+                                                }}};
+  }
+
+  const state_t &state() const { return _current_state; }
+
+ private:
+  using subscribers_t = std::unordered_map<int, state_subscribe_t<state_t>>;
+
+  template <std::size_t I, class Action>
+  std::enable_if_t<(I < sizeof...(Middlewares))> dispatch_from(const Action &action) {
+    std::get<I>(_middlewares)(*this, action, [this](const auto &next_action) {
+      using next_action_t = std::decay_t<decltype(next_action)>;
+      static_assert(action_set_t::template contains<next_action_t>(),
+                    "action is not part of the store's action set");
+      dispatch_from<I + 1>(next_action);
+    });
+  }
+
+  template <std::size_t I, class Action>
+  std::enable_if_t<(I == sizeof...(Middlewares))> dispatch_from(const Action &action) {
+    if (_is_dispatching) {
+      return;
+    }
+
+    {
+      dispatching_guard guard{_is_dispatching};
+      _current_state = detail::reduce_value(_reducer, _current_state, action, detail::priority<1>{});
+    }
+
+    for (const auto &pair : *_subscribers) pair.second(_current_state);
+  }
+
+  // Clears the flag again when the reducer throws, so the store keeps accepting actions.
+  struct dispatching_guard {
+    explicit dispatching_guard(bool &flag) : _flag(flag) { _flag = true; }
+    ~dispatching_guard() { _flag = false; }
+
+    bool &_flag;
+  };
+
+  struct disposable_holder {
+    basic_disposable<>::disposed_t disposed() const { return _disposed; }
+    basic_disposable<>::disposable_t disposable() const { return _disposer; }
+
+    basic_disposable<>::disposed_t _disposed;
+    basic_disposable<>::disposable_t _disposer;
+  };
+
+  Reducer _reducer;
+  std::tuple<Middlewares...> _middlewares;
+  state_t _current_state;
+  int _next_id{0};
+  std::shared_ptr<subscribers_t> _subscribers;
+  bool _is_dispatching{false};
+};
+
+template <class State, class... Actions, class Reducer, class... Middlewares>
+basic_static_store<State, action_set<Actions...>, Reducer, Middlewares...> create_static_store(
+    action_set<Actions...>, Reducer reducer, State initial_state, Middlewares... middlewares) {
+  return {std::move(reducer), std::move(initial_state), std::move(middlewares)...};
+}
+
+}  // namespace flow
@@ -1,14 +1,60 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <experimental/optional>
+#include <memory>
+#include <numeric>
+#include <tuple>
+#include <type_traits>
 #include <unordered_map>
+#include <vector>
 
 #include "common.h"
 #include "disposable.hpp"
 #include "middleware.hpp"
+#include "traits.hpp"
+#include "type_id_map.hpp"
 
 namespace flow {
 
+// Adapts a reducer to in_place_reducer_t. Reducers returning void are called as `reducer(State &, const action &)`
+// and mutate the state directly. Any other reducer has its result assigned to the state: a reducer taking `State &&`
+// gets the state moved in, one taking `State` gets a copy, so it cannot lose the state by throwing.
+template <class State, class Reducer>
+std::enable_if_t<std::is_void<decltype(std::declval<Reducer &>()(std::declval<State &>(),
+                                                                   std::declval<const action &>()))>::value,
+                 in_place_reducer_t<State>>
+to_in_place_reducer(Reducer reducer) {
+  return reducer;
+}
+
+template <class State, class Reducer>
+std::enable_if_t<!std::is_void<decltype(std::declval<Reducer &>()(std::declval<State>(),
+                                                                    std::declval<const action &>()))>::value,
+                 in_place_reducer_t<State>>
+to_in_place_reducer(Reducer reducer) {
+  return [reducer](State &state, const action &action) mutable {
+    state = detail::reduce_value(reducer, state, action, detail::priority<1>{});
+  };
+}
+
+namespace detail {
+
+// Reducer over one action type, handed the user struct wrapped by the action instead of the action itself.
+template <class Action, class Reducer>
+struct typed_reducer {
+  template <class S>
+  auto operator()(S &&state, const action &action)
+      -> decltype(std::declval<Reducer &>()(std::forward<S>(state), std::declval<const Action &>())) {
+    return reducer(std::forward<S>(state), *action.template try_as<Action>());
+  }
+
+  Reducer reducer;
+};
+
+}  // namespace detail
+
 // store
 template <class State>
 class basic_store {
@@ -20,49 +66,161 @@ class basic_store {
 
   action_t dispatch(std::function<action_t()> action_creator) { return _dispatcher(action_creator()); }
 
-  action_t dispatch(action_t action) { return _dispatcher(action); }
+  action_t dispatch(const action_t &action) { return _dispatcher(action); }
+
+  // Dispatches every action in [first, last) through the middleware chain, notifying subscribers once at the end.
+  template <class Iterator>
+  void dispatch_batch(Iterator first, Iterator last) {
+    batch([&] {
+      for (; first != last; ++first) _dispatcher(*first);
+    });
+  }
+
+  // Runs `f`, deferring the notifications of every dispatch it makes to a single one after it returns. Batches nest.
+  // If `f` throws, the outermost batch still notifies the subscribers of the actions reduced before rethrowing.
+  template <class F>
+  void batch(F &&f) {
+    ++_batch_depth;
+    try {
+      f();
+    } catch (...) {
+      if (--_batch_depth == 0 && _notify_pending) notify();
+      throw;
+    }
+    if (--_batch_depth == 0 && _notify_pending) notify();
+  }
+
+  // Routes actions wrapping an `Action` to `reducer`, called with the state like any reducer and with `const Action &`.
+  // Action types with routes are reduced by their routes only, found through a flat table keyed by type id; all other
+  // actions still go to the store's reducer.
+  template <class Action, class Reducer>
+  basic_store &on(Reducer reducer) {
+    _routes[type_id<Action>()].push_back(
+        to_in_place_reducer<state_t>(detail::typed_reducer<Action, Reducer>{std::move(reducer)}));
+    return *this;
+  }
 
   basic_disposable<> subscribe(state_subscribe_t<state_t> subscriber) const {
-    subscriber(_current_state);
+    subscriber(*_current_state);
     return _subscribing(subscriber);
   }
 
-  state_t state() const { return _current_state; }
+  // Subscribes to a projection of the state: `subscriber(slice)` is called with `selector(state)` now and after each
+  // dispatch where the slice changed according to `same_value`, instead of after every dispatch.
+  template <class Selector, class Subscriber>
+  basic_disposable<> subscribe(Selector selector, Subscriber subscriber) const {
+    using slice_t = std::decay_t<decltype(selector(std::declval<const state_t &>()))>;
+    auto last = std::make_shared<slice_t>(selector(*_current_state));
+    subscriber(*last);
 
-  template <class S>
-  friend basic_store<S> create_store(std::function<S(S, action)> reducer, const S &initial_state);
+    return _subscribing([selector, subscriber, last](const state_t &state) mutable {
+      auto slice = selector(state);
+      if (same_value(*last, slice, detail::priority<2>())) return;
+      *last = std::move(slice);
+      subscriber(*last);
+    });
+  }
 
-  template <class S>
-  friend basic_store<S> create_store_with_action(std::function<S(S, action)> reducer, const S &initial_state,
+  // Subscribers sharing an immutable snapshot of each state instead of borrowing it for the duration of the call.
+  // The store only copies its state before the next dispatch if a snapshot is still being held on to.
+  basic_disposable<> subscribe_snapshot(snapshot_subscribe_t<state_t> subscriber) const {
+    subscriber(_current_state);
+    return _subscribing([this, subscriber](const state_t &) { subscriber(_current_state); });
+  }
+
+  const state_t &state() const { return *_current_state; }
+
+  // True while the reducer runs; actions dispatched meanwhile are dropped.
+  bool reducing() const { return _is_dispatching; }
+
+  // Number of actions the reducer has returned from, so not counting those it threw on.
+  std::size_t reduced() const { return _reduced; }
+
+  std::shared_ptr<const state_t> snapshot() const { return _current_state; }
+
+  // Reduces `action` into `state` the way a dispatch reduces it into the store's state, through the routes of its type
+  // or the reducer, but without middleware or subscribers. For rebuilding states from recorded actions.
+  void replay(state_t &state, const action_t &action) const {
+    if (auto routes = _routes.find(action.id())) {
+      for (auto &route : *routes) route(state, action);
+    } else {
+      _reducer(state, action);
+    }
+  }
+
+  // Sets the state without going through the middleware or the reducer, e.g. to travel back in history, and notifies
+  // the subscribers. Not to be called from a reducer.
+  void replace_state(state_t state) {
+    _current_state = std::make_shared<state_t>(std::move(state));
+    if (_batch_depth > 0) {
+      _notify_pending = true;
+    } else {
+      notify();
+    }
+  }
+
+  template <class S, class Reducer>
+  friend basic_store<S> create_store(Reducer reducer, const S &initial_state);
+
+  template <class S, class Reducer>
+  friend basic_store<S> create_store_with_action(Reducer reducer, const S &initial_state,
                                                  const action &initial_action);
 
-  template <class S>
+  template <class S, class Reducer>
   friend basic_store<S> apply_middleware(
-      reducer_t<S> reducer, const S &state,
+      Reducer reducer, const S &state,
       std::initializer_list<std::function<dispatch_transformer_t(basic_middleware<S>)>> transformers);
 
+  template <class S, class Reducer, class... Middlewares>
+  friend basic_store<S> apply_middleware(Reducer reducer, const S &state, Middlewares... middlewares);
+
+  template <class S>
+  friend class basic_concurrent_store;
+
  private:
-  static basic_store<state_t> create(const std::function<state_t(state_t, action)> reducer, const state_t initial_state,
+  static basic_store<state_t> create(in_place_reducer_t<state_t> reducer, state_t initial_state,
                                      const std::experimental::optional<action> initial_action) {
-    auto state = (initial_action) ? reducer(initial_state, *initial_action) : initial_state;
-    return basic_store<state_t>(reducer, state);
+    if (initial_action) reducer(initial_state, *initial_action);
+    return basic_store<state_t>(std::move(reducer), std::move(initial_state));
   }
 
-  basic_store(reducer_t<state_t> reducer, state_t initial_state) : _reducer(reducer), _current_state(initial_state) {
-    _dispatcher = [&](action_t action) -> action_t {
+  action_t reduce(const action_t &action) {
+    if (_is_dispatching) {
+      return action;
+    }
 
-      if (_is_dispatching) {
-        return action;
-      }
+    // copy on write: only clone the state when a snapshot of it is still alive. use_count is a relaxed load, so the
+    // fence orders the writes below after the reads of a snapshot dropped on another thread.
+    if (_current_state.use_count() > 1) {
+      _current_state = std::make_shared<state_t>(*_current_state);
+    } else {
+      std::atomic_thread_fence(std::memory_order_acquire);
+    }
 
-      _is_dispatching = true;
-      _current_state = _reducer(_current_state, action);
-      _is_dispatching = false;
+    // a reducer that throws leaves the state as it left it, and the store goes on reducing later actions
+    {
+      dispatching_guard guard{_is_dispatching};
+      replay(*_current_state, action);
+    }
+    ++_reduced;
 
-      std::for_each(std::begin(_subscribers), std::end(_subscribers),
-                    [&](const auto &pair) { pair.second(_current_state); });
-      return action;
-    };
+    if (_batch_depth > 0) {
+      _notify_pending = true;
+    } else {
+      notify();
+    }
+    return action;
+  }
+
+  void notify() {
+    _notify_pending = false;
+    const auto &state = *_current_state;
+    std::for_each(std::begin(_subscribers), std::end(_subscribers), [&](const auto &pair) { pair.second(state); });
+  }
+
+  basic_store(in_place_reducer_t<state_t> reducer, state_t initial_state)
+      : _reducer(std::move(reducer)), _current_state(std::make_shared<state_t>(std::move(initial_state))) {
+    _dispatcher = [&](const action_t &action) -> action_t { return reduce(action); };
 
     _subscribing = [&](state_subscribe_t<state_t> subscriber) -> basic_disposable<> {
       int id = _next_id++;
@@ -74,12 +232,15 @@ class basic_store {
     };
   }
 
-  basic_store(reducer_t<state_t> reducer, state_t initial_state,
+  basic_store(in_place_reducer_t<state_t> reducer, state_t initial_state,
               std::initializer_list<std::function<dispatch_transformer_t(basic_middleware<state_t>)>> transformer)
-      : basic_store(reducer, initial_state) {
+      : basic_store(std::move(reducer), std::move(initial_state)) {
     _dispatcher = std::accumulate(
         std::begin(transformer), std::end(transformer), _dispatcher, [&](dispatch_t acc, auto f) -> dispatch_t {
-          auto middleware = basic_middleware<state_t>{middleware_holder{_dispatcher, [&]() { return _current_state; }}};
+          auto middleware = basic_middleware<state_t>{
+              middleware_holder{_dispatcher, [&]() -> const state_t & { return *_current_state; },
+                                [&](const std::function<void()> &f) { batch(f); }, [&] { return reducing(); },
+                                [&] { return reduced(); }}};
 
           auto dispatch_transformer = f(middleware);
 
@@ -87,16 +248,51 @@ class basic_store {
         });
   }
 
-  std::function<state_t(state_t, action)> _reducer;
-  state_t _current_state;
+  // Statically composed middleware: the whole chain sits behind one std::function and each layer calls the next
+  // directly, so the optimizer can inline it down to the reducer.
+  template <class... Middlewares>
+  basic_store(in_place_reducer_t<state_t> reducer, state_t initial_state, std::tuple<Middlewares...> middlewares)
+      : basic_store(std::move(reducer), std::move(initial_state)) {
+    _dispatcher = [this, middlewares](const action_t &action) mutable -> action_t {
+      return dispatch_through<0>(middlewares, action);
+    };
+  }
+
+  template <std::size_t I, class Middlewares>
+  std::enable_if_t<(I < std::tuple_size<Middlewares>::value), action_t> dispatch_through(Middlewares &middlewares,
+                                                                                         const action_t &action) {
+    return std::get<I>(middlewares)(*this, action, [this, &middlewares](const action_t &next_action) -> action_t {
+      return dispatch_through<I + 1>(middlewares, next_action);
+    });
+  }
+
+  template <std::size_t I, class Middlewares>
+  std::enable_if_t<(I == std::tuple_size<Middlewares>::value), action_t> dispatch_through(Middlewares &,
+                                                                                          const action_t &action) {
+    return reduce(action);
+  }
+
+  in_place_reducer_t<state_t> _reducer;
+  type_id_map<std::vector<in_place_reducer_t<state_t>>> _routes;
+  std::shared_ptr<state_t> _current_state;
   int _next_id{0};
   std::unordered_map<int, state_subscribe_t<state_t>> _subscribers;
   bool _is_dispatching{false};
+  std::size_t _reduced{0};
+  int _batch_depth{0};
+  bool _notify_pending{false};
 
   dispatch_t _dispatcher;
   subscribe_t<state_t> _subscribing;
 
   // helpers
+  struct dispatching_guard {
+    explicit dispatching_guard(bool &flag) : _flag(flag) { _flag = true; }
+    ~dispatching_guard() { _flag = false; }
+
+    bool &_flag;
+  };
+
   struct disposable_holder {
     basic_disposable<>::disposed_t disposed() const { return _disposed; }
     basic_disposable<>::disposable_t disposable() const { return _disposer; }
@@ -108,9 +304,15 @@ class basic_store {
   struct middleware_holder {
     dispatch_t dispatch() const { return _dispatch; }
     get_state_t<state_t> get_state() const { return _get_state; }
+    batch_t batch() const { return _batch; }
+    bool reducing() const { return _reducing(); }
+    std::size_t reduced() const { return _reduced(); }
 
     dispatch_t _dispatch;
     get_state_t<state_t> _get_state;
+    batch_t _batch;
+    std::function<bool()> _reducing;
+    std::function<std::size_t()> _reduced;
   };
 };
 
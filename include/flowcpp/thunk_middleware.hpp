@@ -1,24 +1,15 @@
 #pragma once
 
+#include <functional>
+
+#include "action.hpp"
+#include "middleware.hpp"
+
 namespace flow {
 
 template <class State>
 using thunk_t = std::function<void(const flow::dispatch_t, const flow::get_state_t<State>)>;
 
-template <class State, class ActionType>
-auto thunk_middleware = [](flow::basic_middleware<State> middleware) {
-  return [=](const flow::dispatch_t &dispatch) {
-    return [=](flow::action action) -> flow::action {
-      auto type = action.type().as<ActionType>();
-      if (type == ActionType::thunk) {
-        auto payload = action.payload().as<thunk_t<State>>();
-        payload(dispatch, middleware.get_state());
-      }
-      return dispatch(action);
-    };
-  };
-};
-
 template <class State, class ActionType>
 struct thunk_action {
   flow::any payload() const { return _payload; }
@@ -32,4 +23,35 @@ struct thunk_action {
   bool _error = false;
 };
 
+// Thunks are recognized by the type the action wraps, `thunk_action<State, ActionType>`, which the action recorded
+// when it was constructed: other actions cost one id comparison and are passed on untouched. A thunk is run and not
+// passed on. With `batched`, every action a thunk dispatches synchronously is reduced before subscribers are
+// notified, once.
+template <class State, class ActionType>
+auto make_thunk_middleware(bool batched) {
+  return [batched](flow::basic_middleware<State> middleware) {
+    return [=](const flow::dispatch_t &dispatch) {
+      return [=](const flow::action &action) -> flow::action {
+        auto thunk = action.try_as<thunk_action<State, ActionType>>();
+        if (!thunk) return dispatch(action);
+
+        auto run = [&] { thunk->_payload(dispatch, middleware.get_state()); };
+        if (batched) {
+          // a reference_wrapper fits in std::function's inline storage, the lambda itself would be allocated
+          middleware.batch()(std::ref(run));
+        } else {
+          run();
+        }
+        return action;
+      };
+    };
+  };
+}
+
+template <class State, class ActionType>
+auto thunk_middleware = make_thunk_middleware<State, ActionType>(false);
+
+template <class State, class ActionType>
+auto batched_thunk_middleware = make_thunk_middleware<State, ActionType>(true);
+
 }  // namespace flow
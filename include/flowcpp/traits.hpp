@@ -0,0 +1,50 @@
+#pragma once
+
+#include <memory>
+#include <utility>
+
+namespace flow {
+namespace detail {
+
+// Overload ranking for detection idioms: pass `priority<N>{}` and the viable overload with the highest N wins.
+template <int N>
+struct priority : priority<N - 1> {};
+
+template <>
+struct priority<0> {};
+
+// Calls a reducer returning the new state without risking the current one: reducers that accept a const lvalue (taking
+// `State` or `const State &`) are handed `state` itself, so one that throws leaves it as it was. Only reducers taking
+// `State &&` get it moved in.
+template <class Reducer, class State, class Action>
+auto reduce_value(Reducer &reducer, State &state, const Action &action, priority<1>)
+    -> decltype(reducer(static_cast<const State &>(state), action)) {
+  return reducer(static_cast<const State &>(state), action);
+}
+
+template <class Reducer, class State, class Action>
+auto reduce_value(Reducer &reducer, State &state, const Action &action, priority<0>)
+    -> decltype(reducer(std::move(state), action)) {
+  return reducer(std::move(state), action);
+}
+
+}  // namespace detail
+
+// Change detection used by memoizers, selector graphs and slice subscriptions: shared pointers compare by address,
+// persistent containers by version (`identical`) before operator==, everything else with operator==.
+template <typename T>
+auto same_value(T const &left, T const &right, detail::priority<2>) -> decltype(left.identical(right)) {
+  return left.identical(right) || left == right;
+}
+
+template <typename T>
+bool same_value(std::shared_ptr<T> const &left, std::shared_ptr<T> const &right, detail::priority<1>) {
+  return left == right;
+}
+
+template <typename T>
+bool same_value(T const &left, T const &right, detail::priority<0>) {
+  return left == right;
+}
+
+}  // namespace flow
@@ -0,0 +1,22 @@
+#pragma once
+
+namespace flow {
+
+// Identity of a type without RTTI: every T owns a distinct static tag, so its address is unique per type and
+// comparing two ids is a single pointer compare. Works with -fno-rtti; ids are not stable across processes.
+using type_id_t = const void *;
+
+template <class T>
+struct type_tag {
+  static constexpr char id{0};
+};
+
+template <class T>
+constexpr char type_tag<T>::id;
+
+template <class T>
+constexpr type_id_t type_id() {
+  return &type_tag<T>::id;
+}
+
+}  // namespace flow
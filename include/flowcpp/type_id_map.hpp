@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "type_id.hpp"
+
+namespace flow {
+
+// Map from type ids to values for routing actions by type. Keys live in one flat power-of-two array, placed by
+// Fibonacci hashing of the tag address and probed linearly, with the table kept at most half full: a lookup is a
+// multiply, a shift and usually a single compare, without the node hops of std::unordered_map. Entries are never
+// removed, which fits registration tables that only grow.
+template <class V>
+class type_id_map {
+ public:
+  std::size_t size() const { return _size; }
+
+  bool empty() const { return _size == 0; }
+
+  V *find(type_id_t id) { return const_cast<V *>(static_cast<const type_id_map &>(*this).find(id)); }
+
+  // Null for an id never inserted, including the null id of an empty action, which matches no empty slot.
+  const V *find(type_id_t id) const {
+    if (_size == 0) return nullptr;
+    for (auto i = index_of(id);; i = (i + 1) & (_slots.size() - 1)) {
+      const auto &s = _slots[i];
+      if (!s.key) return nullptr;
+      if (s.key == id) return &s.value;
+    }
+  }
+
+  // Inserts a default constructed value for a new id.
+  V &operator[](type_id_t id) {
+    if (!id) throw std::invalid_argument("flow: type_id_map cannot hold the null type id");
+    if (auto value = find(id)) return *value;
+    if (2 * (_size + 1) > _slots.size()) rehash(_slots.empty() ? 8 : 2 * _slots.size());
+    ++_size;
+    return insert(id, V())->value;
+  }
+
+ private:
+  struct slot {
+    type_id_t key{nullptr};
+    V value;
+  };
+
+  std::size_t index_of(type_id_t id) const {
+    return static_cast<std::size_t>((reinterpret_cast<std::uintptr_t>(id) * UINT64_C(0x9E3779B97F4A7C15)) >> _shift);
+  }
+
+  slot *insert(type_id_t id, V value) {
+    auto i = index_of(id);
+    while (_slots[i].key) i = (i + 1) & (_slots.size() - 1);
+    _slots[i].key = id;
+    _slots[i].value = std::move(value);
+    return &_slots[i];
+  }
+
+  void rehash(std::size_t capacity) {
+    auto previous = std::move(_slots);
+    _slots = std::vector<slot>(capacity);
+    _shift = 64;
+    for (auto c = capacity; c > 1; c >>= 1) --_shift;
+    for (auto &s : previous) {
+      if (s.key) insert(s.key, std::move(s.value));
+    }
+  }
+
+  std::vector<slot> _slots;
+  std::size_t _size{0};
+  unsigned _shift{64};
+};
+
+}  // namespace flow
@@ -34,14 +34,14 @@ struct decrement_action {
 };
 
 struct counter_state {
-  std::string to_string() { return "counter: " + std::to_string(_counter); }
+  std::string to_string() const { return "counter: " + std::to_string(_counter); }
 
   int _counter{0};
 };
 
-auto reducer = [](counter_state state, flow::action action) {
+auto reducer = [](counter_state state, const flow::action &action) {
   int multiplier = 1;
-  auto type = action.type().as<counter_action_type>();
+  auto type = *action.type_ptr<counter_action_type>();
   switch (type) {
     case counter_action_type::decrement:
       multiplier = -1;
@@ -50,10 +50,10 @@ auto reducer = [](counter_state state, flow::action action) {
       multiplier = 1;
       break;
     default:
-      break;
+      return state;
   }
 
-  auto payload = action.payload().as<int>();
+  auto payload = *action.payload_ptr<int>();
   state._counter += multiplier * payload;
   return state;
 };
@@ -73,7 +73,7 @@ auto logging_middleware = [](flow::basic_middleware<counter_state>) {
   return [=](const flow::dispatch_t &next) {
     return [=](flow::action action) {
       auto next_action = next(action);
-      std::cout << "after dispatch: " << to_string(action.type().as<counter_action_type>()) << std::endl;
+      std::cout << "after dispatch: " << to_string(*action.type_ptr<counter_action_type>()) << std::endl;
       return next_action;
     };
   };
@@ -110,11 +110,14 @@ void reselect_example() {
   // auto memoize = flow::default_memoize<std::string, int, int>(equality_checks);  
 
   // Map memoize
-  auto int_key = flow::map_string_key<int>{ [](auto x){
-    return std::to_string(x);
-  }};
-  auto keys = std::make_tuple(int_key, int_key);
-  auto memoize = flow::map_memoize<std::string, int, int>(keys);
+  // auto int_key = flow::map_string_key<int>{ [](auto x){
+  //   return std::to_string(x);
+  // }};
+  // auto keys = std::make_tuple(int_key, int_key);
+  // auto memoize = flow::map_memoize<std::string, int, int>(keys);
+
+  // Hash memoize, hashing each argument with std::hash
+  auto memoize = flow::hash_memoize<std::string, int, int>();
 
   //
   auto show_multiply_selector = 
@@ -217,7 +220,7 @@ void simple_example() {
 
   auto store = flow::create_store_with_action<counter_state>(reducer, counter_state{}, increment_action{5});
 
-  auto disposable = store.subscribe([](counter_state state) { std::cout << state.to_string() << std::endl; });
+  auto disposable = store.subscribe([](const counter_state &state) { std::cout << state.to_string() << std::endl; });
 
   store.dispatch(increment_action{2});
   store.dispatch(decrement_action{10});
@@ -251,6 +254,28 @@ void thunk_middleware_example() {
   std::cout << "End: Thunk Middleware example " << store.state().to_string() << std::endl;
 }
 
+void static_store_example() {
+  std::cout << "Start: Static store example" << std::endl;
+
+  auto static_reducer = [](counter_state state, const auto &action) {
+    state._counter += (action._type == counter_action_type::decrement ? -1 : 1) * action._payload;
+    return state;
+  };
+
+  auto static_logging_middleware = [](auto &, const auto &action, auto next) {
+    next(action);
+    std::cout << "after dispatch: " << to_string(action._type) << std::endl;
+  };
+
+  auto store = flow::create_static_store(flow::action_set<increment_action, decrement_action>{}, static_reducer,
+                                         counter_state{}, static_logging_middleware);
+
+  store.dispatch(increment_action{2});
+  store.dispatch(decrement_action{10});
+
+  std::cout << "End: Static store example " << store.state().to_string() << std::endl;
+}
+
 int main() {
   simple_example();
   std::cout << "------------------------------" << std::endl;
@@ -259,5 +284,7 @@ int main() {
   reselect_example();
   std::cout << "------------------------------" << std::endl;
   combine_selector();
+  std::cout << "------------------------------" << std::endl;
+  static_store_example();
   return 0;
 }
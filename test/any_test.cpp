@@ -0,0 +1,45 @@
+#include <stdexcept>
+#include <string>
+
+#include "test.hpp"
+
+namespace test {
+namespace {
+
+struct throwing_copy {
+  throwing_copy() = default;
+  throwing_copy(const throwing_copy &) { throw std::runtime_error("copy"); }
+  throwing_copy(throwing_copy &&) noexcept = default;
+};
+
+}  // namespace
+
+void any_tests(suite &s) {
+  s.run("any/assign_from_own_value", [&] {
+    flow::any inline_value = 42;
+    inline_value = inline_value.as<int>();
+    FLOW_CHECK(s, inline_value.is<int>() && inline_value.as<int>() == 42);
+
+    flow::any heap_value = std::string(100, 'x');
+    heap_value = heap_value.as<std::string>();
+    FLOW_CHECK(s, heap_value.is<std::string>() && heap_value.as<std::string>() == std::string(100, 'x'));
+  });
+
+  s.run("any/throwing_assignment_keeps_value", [&] {
+    flow::any value = 7;
+    throwing_copy source;
+    auto threw = false;
+    try {
+      value = source;
+    } catch (const std::runtime_error &) {
+      threw = true;
+    }
+    FLOW_CHECK(s, threw);
+    FLOW_CHECK(s, value);
+    FLOW_CHECK(s, value.is<int>());
+    FLOW_CHECK(s, value.try_as<int>() && *value.try_as<int>() == 7);
+    FLOW_CHECK(s, !value.is<throwing_copy>());
+  });
+}
+
+}  // namespace test
@@ -0,0 +1,92 @@
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+#include "test.hpp"
+
+namespace test {
+namespace {
+
+// Runs the foreground tasks until `done` holds, for at most a few seconds.
+template <class Done>
+bool drain_until(flow::task_queue &queue, Done done) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (!done()) {
+    if (std::chrono::steady_clock::now() > deadline) return false;
+    if (queue.run_pending() == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
+// Drops the last reference to a timer queue from whichever thread destroys it, then reports that it got through.
+struct last_owner {
+  ~last_owner() {
+    queue.reset();
+    done->set_value();
+  }
+
+  std::shared_ptr<flow::timer_queue> queue;
+  std::shared_ptr<std::promise<void>> done;
+};
+
+}  // namespace
+
+void async_tests(suite &s) {
+  s.run("async/thread_pool_reports_task_exceptions", [&] {
+    std::atomic<int> errors{0}, ran{0};
+    {
+      flow::thread_pool pool(2, [&](std::exception_ptr) { ++errors; });
+      pool.post([] { throw std::runtime_error("task"); });
+      pool.post([&] { ++ran; });
+      pool.post([&] { ++ran; });
+    }
+    FLOW_CHECK(s, errors == 1);
+    FLOW_CHECK(s, ran == 2);
+  });
+
+  s.run("async/then_continues_when_promise_is_set", [&] {
+    flow::thread_pool pool(2);
+    flow::task_queue main_queue;
+    auto store = flow::apply_middleware<counter_state>(
+        counter_reducer, counter_state{},
+        {flow::make_async_thunk_middleware<counter_state>(pool.executor(), main_queue.executor())});
+
+    flow::async_promise<int> pending, failing, already_set;
+    already_set.set_value(5);
+    std::atomic<int> failures{0};
+    store.dispatch(flow::async_thunk_action<counter_state>{[&](const flow::async_context<counter_state> &ctx) {
+      auto add = [ctx](std::future<int> result) { ctx.dispatch(add_action{result.get()}); };
+      ctx.then(pending.get_future(), add);
+      ctx.then(already_set.get_future(), add);
+      ctx.then(failing.get_future(), [&](std::future<int> result) {
+        try {
+          result.get();
+        } catch (const std::runtime_error &) {
+          ++failures;
+        }
+      });
+    }, {}, false});
+
+    FLOW_CHECK(s, drain_until(main_queue, [&] { return store.state().count == 1; }));
+    pending.set_value(7);
+    failing.set_exception(std::make_exception_ptr(std::runtime_error("failed")));
+    FLOW_CHECK(s, drain_until(main_queue, [&] { return store.state().count == 2 && failures == 1; }));
+    FLOW_CHECK(s, store.state().sum == 5 * 31 + 7);
+  });
+
+  s.run("async/timer_queue_released_by_its_own_task", [&] {
+    auto done = std::make_shared<std::promise<void>>();
+    auto finished = done->get_future();
+    auto queue = std::make_shared<flow::timer_queue>();
+    auto owner = std::shared_ptr<last_owner>(new last_owner{queue, done});
+    queue->post_after(std::chrono::milliseconds(1), [owner] {});
+    owner.reset();
+    queue.reset();
+    FLOW_CHECK(s, finished.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+  });
+}
+
+}  // namespace test
@@ -0,0 +1,63 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "test.hpp"
+
+namespace test {
+
+void concurrent_store_tests(suite &s) {
+  s.run("concurrent_store/state_includes_completed_dispatch", [&] {
+    flow::basic_concurrent_store<counter_state> store(counter_reducer, counter_state{});
+    auto stale = 0;
+    for (int i = 1; i <= 20000; ++i) {
+      store.dispatch(add_action{}).get();
+      if (store.state()->count != i) ++stale;
+    }
+    FLOW_CHECK(s, stale == 0);
+  });
+
+  s.run("concurrent_store/state_includes_completed_callback", [&] {
+    flow::basic_concurrent_store<counter_state> store(counter_reducer, counter_state{});
+    std::atomic<int> stale{0};
+    std::atomic<int> done{0};
+    for (int i = 0; i < 1000; ++i) {
+      store.dispatch(add_action{}, [&](const flow::action &) {
+        if (store.state()->count <= done.load()) ++stale;
+        ++done;
+      });
+    }
+    while (done.load() < 1000) std::this_thread::yield();
+    FLOW_CHECK(s, stale.load() == 0);
+  });
+
+  s.run("concurrent_store/producers", [&] {
+    flow::basic_concurrent_store<counter_state> store(counter_reducer, counter_state{});
+    std::vector<std::thread> producers;
+    for (int t = 0; t < 4; ++t) {
+      producers.emplace_back([&] {
+        for (int i = 0; i < 5000; ++i) store.dispatch(add_action{}, [](const flow::action &) {});
+      });
+    }
+    for (auto &producer : producers) producer.join();
+    store.dispatch(add_action{}).get();
+    FLOW_CHECK(s, store.state()->count == 20001);
+  });
+
+  s.run("concurrent_store/reducer_exception_fails_one_action", [&] {
+    flow::basic_concurrent_store<counter_state> store(counter_reducer, counter_state{});
+    store.dispatch(add_action{});
+    auto rejected = store.dispatch(reject_action{});
+    store.dispatch(add_action{}).get();
+    auto threw = false;
+    try {
+      rejected.get();
+    } catch (const std::runtime_error &) {
+      threw = true;
+    }
+    FLOW_CHECK(s, threw);
+    FLOW_CHECK(s, store.state()->count == 2);
+  });
+}
+
+}  // namespace test
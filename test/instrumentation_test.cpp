@@ -0,0 +1,60 @@
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test.hpp"
+
+namespace test {
+namespace {
+
+struct noop_action {
+  flow::any payload() const { return {}; }
+  flow::any type() const { return {}; }
+  flow::any meta() const { return {}; }
+  bool error() const { return false; }
+};
+
+const flow::action_metrics *find(const std::vector<flow::action_metrics> &report, const std::string &name) {
+  auto found = std::find_if(std::begin(report), std::end(report),
+                            [&](const flow::action_metrics &m) { return m.name == name; });
+  return found == std::end(report) ? nullptr : &*found;
+}
+
+}  // namespace
+
+void instrumentation_tests(suite &s) {
+  s.run("instrumentation/subscribers_per_action_type", [&] {
+    flow::instrumentation metrics;
+    metrics.name<add_action>("add");
+    metrics.name<noop_action>("noop");
+    auto store = flow::apply_middleware<counter_state>(counter_reducer, counter_state{}, metrics.static_middleware());
+    auto subscription = store.subscribe(metrics.subscriber([](const counter_state &) {}));
+
+    for (int i = 0; i < 3; ++i) store.dispatch(add_action{});
+    store.dispatch(noop_action{});
+
+    auto report = metrics.report();
+    auto add = find(report, "add"), noop = find(report, "noop"), none = find(report, "none");
+    FLOW_CHECK(s, add && add->dispatch.count == 3 && add->subscribers.count == 3);
+    FLOW_CHECK(s, noop && noop->dispatch.count == 1 && noop->subscribers.count == 1);
+    FLOW_CHECK(s, none && none->dispatch.count == 0 && none->subscribers.count == 1);
+    subscription.dispose();
+  });
+
+  s.run("instrumentation/name_while_reporting", [&] {
+    flow::instrumentation metrics;
+    std::atomic<bool> naming{true};
+    std::thread reporter([&] {
+      while (naming) metrics.report();
+    });
+    for (int i = 0; i < 1000; ++i) metrics.name<add_action>("add " + std::to_string(i));
+    naming = false;
+    reporter.join();
+    auto report = metrics.report();
+    FLOW_CHECK(s, report.size() == 1 && report[0].name == "add 999");
+  });
+}
+
+}  // namespace test
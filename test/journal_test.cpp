@@ -0,0 +1,200 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#include "test.hpp"
+
+namespace test {
+namespace {
+
+const std::string journal_path = "flow_test.journal";
+const std::string snapshot_path = "flow_test.snapshot";
+
+flow::action_codecs codecs() {
+  flow::action_codecs codecs;
+  codecs.add_trivial<add_action>(1).add_trivial<reject_action>(2);
+  return codecs;
+}
+
+flow::state_codec<counter_state> state_codec() {
+  return {[](const counter_state &state, std::string &out) {
+            out.append(reinterpret_cast<const char *>(&state), sizeof(state));
+          },
+          [](const char *data, std::size_t) {
+            counter_state state;
+            std::memcpy(&state, data, sizeof(state));
+            return state;
+          }};
+}
+
+counter_state replayed(const flow::basic_store<counter_state> &store) {
+  counter_state state;
+  flow::replay_journal(journal_path, codecs(), store, state);
+  return state;
+}
+
+counter_state replayed() { return replayed(flow::create_store<counter_state>(counter_reducer, counter_state{})); }
+
+// Counts add_action like counter_reducer, but sums differently.
+void doubling_route(counter_state &state, const add_action &add) {
+  ++state.count;
+  state.sum += 2 * add._payload;
+}
+
+void remove_files() {
+  std::remove(journal_path.c_str());
+  std::remove(snapshot_path.c_str());
+  std::remove((snapshot_path + ".tmp").c_str());
+}
+
+}  // namespace
+
+void journal_tests(suite &s) {
+  s.run("journal/replay", [&] {
+    remove_files();
+    counter_state live;
+    {
+      flow::journal journal(journal_path, codecs(), {16, 1 << 16, false});
+      auto store = flow::apply_middleware<counter_state>(counter_reducer, counter_state{},
+                                                         {journal.middleware<counter_state>()});
+      for (int i = 0; i < 1000; ++i) store.dispatch(add_action{i});
+      live = store.state();
+    }
+    auto state = replayed();
+    FLOW_CHECK(s, state.count == 1000);
+    FLOW_CHECK(s, state.sum == live.sum);
+  });
+
+  s.run("journal/replay_through_routes", [&] {
+    remove_files();
+    flow::journal journal(journal_path, codecs(), {16, 1 << 16, false});
+    auto store = flow::apply_middleware<counter_state>(counter_reducer, counter_state{}, journal.static_middleware());
+    store.on<add_action>(doubling_route);
+    for (int i = 0; i < 100; ++i) store.dispatch(add_action{i});
+    journal.flush();
+
+    auto replay_store = flow::create_store<counter_state>(counter_reducer, counter_state{});
+    replay_store.on<add_action>(doubling_route);
+    auto state = replayed(replay_store);
+    FLOW_CHECK(s, state.count == 100);
+    FLOW_CHECK(s, state.sum == store.state().sum);
+    FLOW_CHECK(s, replay_store.state().count == 0);
+  });
+
+  s.run("journal/subscriber_exception_keeps_action", [&] {
+    remove_files();
+    {
+      flow::journal journal(journal_path, codecs(), {16, 1 << 16, false});
+      auto store = flow::apply_middleware<counter_state>(counter_reducer, counter_state{},
+                                                         {journal.middleware<counter_state>()});
+      auto subscription = store.subscribe([](const counter_state &state) {
+        if (state.count == 2) throw std::runtime_error("subscriber");
+      });
+      auto threw = false;
+      for (int i = 0; i < 3; ++i) {
+        try {
+          store.dispatch(add_action{i});
+        } catch (const std::runtime_error &) {
+          threw = true;
+        }
+      }
+      FLOW_CHECK(s, threw);
+      FLOW_CHECK(s, store.state().count == 3);
+    }
+    FLOW_CHECK(s, replayed().count == 3);
+  });
+
+  s.run("journal/torn_tail", [&] {
+    remove_files();
+    {
+      flow::journal journal(journal_path, codecs(), {1, 1 << 16, false});
+      for (int i = 0; i < 10; ++i) journal.append(add_action{i});
+    }
+    {
+      std::ofstream out(journal_path, std::ios::binary | std::ios::app);
+      out.write("\x04\x00\x00\x00\x01\x00", 6);  // a record cut short by a crash
+    }
+    FLOW_CHECK(s, replayed().count == 10);
+
+    {
+      flow::journal journal(journal_path, codecs(), {1, 1 << 16, false});
+      for (int i = 10; i < 15; ++i) journal.append(add_action{i});
+    }
+    FLOW_CHECK(s, replayed().count == 15);
+
+    {
+      std::fstream file(journal_path, std::ios::binary | std::ios::in | std::ios::out);
+      file.seekp(-2, std::ios::end);
+      file.put('\x7f');  // corrupts the checksum of the last record
+    }
+    FLOW_CHECK(s, replayed().count == 14);
+  });
+
+  s.run("journal/rejected_and_dropped_actions", [&] {
+    remove_files();
+    counter_state live;
+    {
+      flow::journal journal(journal_path, codecs(), {16, 1 << 16, false});
+      flow::basic_store<counter_state> *self = nullptr;
+      auto reducer = [&](counter_state &state, const flow::action &action) {
+        counter_reducer(state, action);
+        if (self) self->dispatch(add_action{1000});  // dropped by the store
+      };
+      auto store = flow::apply_middleware<counter_state>(reducer, counter_state{}, journal.static_middleware());
+      self = &store;
+
+      auto reacted = false;
+      auto subscription = store.subscribe([&](const counter_state &state) {
+        if (state.count == 1 && !reacted) {
+          reacted = true;
+          store.dispatch(add_action{7});
+        }
+      });
+      store.dispatch(add_action{3});
+      try {
+        store.dispatch(reject_action{});
+      } catch (const std::runtime_error &) {
+      }
+      store.dispatch(add_action{5});
+      live = store.state();
+      self = nullptr;
+    }
+    auto state = replayed();
+    FLOW_CHECK(s, live.count == 3);
+    FLOW_CHECK(s, state.count == live.count);
+    FLOW_CHECK(s, state.sum == live.sum);
+    remove_files();
+  });
+
+  s.run("journal/snapshot_restore", [&] {
+    remove_files();
+    auto run = [&](int actions) {
+      flow::journal journal(journal_path, codecs(), {7, 1 << 16, false});
+      auto store =
+          flow::apply_middleware<counter_state>(counter_reducer, counter_state{}, journal.static_middleware());
+      store.on<add_action>(doubling_route);
+      store.replace_state(
+          flow::restore_state(snapshot_path, state_codec(), journal_path, codecs(), store, counter_state{}));
+      flow::state_snapshots<counter_state> snapshots(snapshot_path, state_codec(), journal, {13, false, {}});
+      snapshots.attach(store);
+      for (int i = 0; i < actions; ++i) {
+        try {
+          if (i % 17 == 0) store.dispatch(reject_action{});
+        } catch (const std::runtime_error &) {
+        }
+        store.dispatch(add_action{i});
+      }
+      snapshots.wait();
+      return store.state();
+    };
+    run(500);
+    auto live = run(333);
+    auto restored = run(0);
+    FLOW_CHECK(s, restored.count == 833);
+    FLOW_CHECK(s, restored.sum == live.sum);
+    remove_files();
+  });
+}
+
+}  // namespace test
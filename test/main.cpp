@@ -0,0 +1,20 @@
+#include "test.hpp"
+
+// Usage: flow_test [filter], running only the tests whose name contains `filter`. A filter matching no test fails.
+int main(int argc, char **argv) {
+  test::suite s(argc > 1 ? argv[1] : "");
+  test::concurrent_store_tests(s);
+  test::store_tests(s);
+  test::persistent_tests(s);
+  test::journal_tests(s);
+  test::any_tests(s);
+  test::type_id_map_tests(s);
+  test::async_tests(s);
+  test::instrumentation_tests(s);
+
+  if (s.ran() == 0) {
+    std::cout << "no test matches the filter" << std::endl;
+    return 1;
+  }
+  return s.failures() == 0 ? 0 : 1;
+}
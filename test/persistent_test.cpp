@@ -0,0 +1,107 @@
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "test.hpp"
+
+namespace test {
+namespace {
+
+template <class T>
+bool same_elements(const flow::persistent_vector<T> &vector, const std::vector<T> &expected) {
+  if (vector.size() != expected.size()) return false;
+  for (std::size_t i = 0; i < expected.size(); ++i) {
+    if (vector[i] != expected[i]) return false;
+  }
+  return std::equal(std::begin(vector), std::end(vector), std::begin(expected));
+}
+
+template <class K, class V>
+bool same_elements(const flow::persistent_map<K, V> &map, const std::unordered_map<K, V> &expected) {
+  if (map.size() != expected.size()) return false;
+  for (const auto &pair : expected) {
+    auto value = map.find(pair.first);
+    if (!value || *value != pair.second) return false;
+  }
+  std::size_t visited = 0;
+  for (const auto &pair : map) {
+    auto it = expected.find(pair.first);
+    if (it == std::end(expected) || it->second != pair.second) return false;
+    ++visited;
+  }
+  return visited == expected.size();
+}
+
+}  // namespace
+
+void persistent_tests(suite &s) {
+  s.run("persistent/vector_against_std_vector", [&] {
+    std::mt19937 random(42);
+    flow::persistent_vector<int> vector;
+    std::vector<int> expected;
+    std::vector<std::pair<flow::persistent_vector<int>, std::vector<int>>> versions;
+
+    for (int step = 0; step < 20000; ++step) {
+      auto op = random() % 10;
+      if (op < 6 || expected.empty()) {
+        auto value = static_cast<int>(random());
+        vector = vector.push_back(value);
+        expected.push_back(value);
+      } else if (op < 8) {
+        auto index = random() % expected.size();
+        auto value = static_cast<int>(random());
+        vector = vector.set(index, value);
+        expected[index] = value;
+      } else {
+        vector = vector.pop_back();
+        expected.pop_back();
+      }
+      if (step % 1000 == 0) versions.emplace_back(vector, expected);
+    }
+
+    FLOW_CHECK(s, same_elements(vector, expected));
+    for (const auto &version : versions) FLOW_CHECK(s, same_elements(version.first, version.second));
+  });
+
+  s.run("persistent/map_against_std_unordered_map", [&] {
+    std::mt19937 random(7);
+    flow::persistent_map<int, int> map;
+    std::unordered_map<int, int> expected;
+    std::vector<std::pair<flow::persistent_map<int, int>, std::unordered_map<int, int>>> versions;
+
+    for (int step = 0; step < 20000; ++step) {
+      auto key = static_cast<int>(random() % 3000);
+      if (random() % 4 == 0) {
+        map = map.erase(key);
+        expected.erase(key);
+      } else {
+        auto value = static_cast<int>(random());
+        map = map.set(key, value);
+        expected[key] = value;
+      }
+      if (step % 1000 == 0) versions.emplace_back(map, expected);
+    }
+
+    FLOW_CHECK(s, same_elements(map, expected));
+    for (const auto &version : versions) FLOW_CHECK(s, same_elements(version.first, version.second));
+  });
+
+  s.run("persistent/map_colliding_hashes", [&] {
+    struct bad_hash {
+      std::size_t operator()(int key) const { return static_cast<std::size_t>(key % 4); }
+    };
+    flow::persistent_map<int, int, bad_hash> map;
+    for (int i = 0; i < 200; ++i) map = map.set(i, i * i);
+    for (int i = 0; i < 200; i += 2) map = map.erase(i);
+    auto found = 0;
+    for (int i = 0; i < 200; ++i) {
+      auto value = map.find(i);
+      if (i % 2 == 1 && value && *value == i * i) ++found;
+      if (i % 2 == 0 && value) --found;
+    }
+    FLOW_CHECK(s, map.size() == 100);
+    FLOW_CHECK(s, found == 100);
+  });
+}
+
+}  // namespace test
@@ -0,0 +1,166 @@
+#include "test.hpp"
+
+namespace test {
+namespace {
+
+struct sliced_state {
+  long added{0};
+  long rejected{0};
+};
+
+}  // namespace
+
+void store_tests(suite &s) {
+  s.run("store/reducer_exception_leaves_store_usable", [&] {
+    auto store = flow::create_store<counter_state>(counter_reducer, counter_state{});
+    store.dispatch(add_action{});
+    auto threw = false;
+    try {
+      store.dispatch(reject_action{});
+    } catch (const std::runtime_error &) {
+      threw = true;
+    }
+    store.dispatch(add_action{});
+    store.dispatch(add_action{});
+    FLOW_CHECK(s, threw);
+    FLOW_CHECK(s, store.state().count == 3);
+  });
+
+  s.run("store/by_value_reducer_exception_keeps_state", [&] {
+    auto store = flow::create_store<std::vector<int>>(
+        [](std::vector<int> state, const flow::action &action) {
+          if (action.is<reject_action>()) throw std::runtime_error("rejected");
+          state.push_back(action.try_as<add_action>()->_payload);
+          return state;
+        },
+        std::vector<int>{});
+    store.dispatch(add_action{1});
+    store.dispatch(add_action{2});
+    auto threw = false;
+    try {
+      store.dispatch(reject_action{});
+    } catch (const std::runtime_error &) {
+      threw = true;
+    }
+    store.dispatch(add_action{3});
+    FLOW_CHECK(s, threw);
+    FLOW_CHECK(s, (store.state() == std::vector<int>{1, 2, 3}));
+  });
+
+  s.run("store/static_store_reducer_exception_leaves_store_usable", [&] {
+    auto store = flow::create_static_store(flow::action_set<add_action, reject_action>{},
+                                           [](counter_state state, const auto &action) {
+                                             counter_reducer(state, action);
+                                             return state;
+                                           },
+                                           counter_state{});
+    store.dispatch(add_action{});
+    auto threw = false;
+    try {
+      store.dispatch(reject_action{});
+    } catch (const std::runtime_error &) {
+      threw = true;
+    }
+    store.dispatch(add_action{});
+    FLOW_CHECK(s, threw);
+    FLOW_CHECK(s, store.state().count == 2);
+  });
+
+  s.run("store/throwing_batch_notifies", [&] {
+    auto store = flow::create_store<counter_state>(counter_reducer, counter_state{});
+    long notified = -1;
+    auto subscription = store.subscribe([&](const counter_state &state) { notified = state.count; });
+    auto threw = false;
+    try {
+      store.batch([&] {
+        store.batch([&] {
+          store.dispatch(add_action{});
+          store.dispatch(add_action{});
+        });
+        FLOW_CHECK(s, notified == 0);
+        store.dispatch(reject_action{});
+      });
+    } catch (const std::runtime_error &) {
+      threw = true;
+    }
+    FLOW_CHECK(s, threw);
+    FLOW_CHECK(s, notified == 2);
+    subscription.dispose();
+  });
+
+  s.run("store/dirty_mask_covers_batch", [&] {
+    auto reducer = flow::combine_reducers<sliced_state>()
+                       .on<add_action>(&sliced_state::added,
+                                       [](const long &added, const add_action &add) { return added + add._payload; })
+                       .on<reject_action>(&sliced_state::rejected,
+                                          [](long &rejected, const reject_action &) { ++rejected; });
+    auto store = flow::create_store<sliced_state>(reducer, sliced_state{});
+    std::vector<flow::combined_reducer<sliced_state>::mask_t> seen;
+    auto subscription = store.subscribe([&](const sliced_state &) { seen.push_back(reducer.dirty()); });
+
+    auto added = reducer.mask(&sliced_state::added), rejected = reducer.mask(&sliced_state::rejected);
+    store.batch([&] {
+      store.dispatch(add_action{});
+      store.dispatch(reject_action{});
+      store.dispatch(add_action{});
+    });
+    store.dispatch(add_action{});
+    store.dispatch(add_action{0});
+
+    FLOW_CHECK(s, seen.size() == 4);
+    FLOW_CHECK(s, (seen[0] & (added | rejected)) == (added | rejected));
+    FLOW_CHECK(s, seen[1] == (added | rejected));
+    FLOW_CHECK(s, seen[2] == added);
+    FLOW_CHECK(s, seen[3] == 0);
+    subscription.dispose();
+  });
+
+  s.run("store/history_replays_through_routes", [&] {
+    flow::history_options<int> options;
+    options.keyframe_interval = 2;
+    flow::state_history<int> history(options);
+    auto store = flow::apply_middleware<int>([](int state, const flow::action &) { return state + 100; }, 0,
+                                             history.static_middleware());
+    store.on<add_action>([](int state, const add_action &add) { return state + add._payload; });
+
+    for (int i = 1; i <= 5; ++i) store.dispatch(add_action{i});
+    FLOW_CHECK(s, store.state() == 15);
+    for (std::size_t p = 0; p <= 5; ++p) FLOW_CHECK(s, history.state_at(store, p) == static_cast<int>(p * (p + 1) / 2));
+
+    FLOW_CHECK(s, history.step_back(store));
+    FLOW_CHECK(s, store.state() == 10);
+    history.jump_to(store, 2);
+    store.dispatch(add_action{10});
+    FLOW_CHECK(s, history.last() == 3);
+    FLOW_CHECK(s, history.state_at(store, 3) == 13);
+    FLOW_CHECK(s, !history.step_forward(store));
+  });
+
+  s.run("store/history_records_in_reduction_order", [&] {
+    flow::state_history<int> history;
+    flow::basic_store<int> *self = nullptr;
+    auto reducer = [&](int state, const flow::action &action) {
+      if (self) self->dispatch(add_action{1000});  // dropped by the store
+      return state + action.try_as<add_action>()->_payload;
+    };
+    auto store = flow::apply_middleware<int>(reducer, 0, {history.middleware()});
+    self = &store;
+    auto subscription = store.subscribe([&](int state) {
+      if (state == 1) store.dispatch(add_action{10});
+    });
+
+    store.dispatch(add_action{1});
+    store.dispatch(add_action{100});
+    self = nullptr;
+
+    FLOW_CHECK(s, store.state() == 111);
+    FLOW_CHECK(s, history.last() == 3);
+    FLOW_CHECK(s, history.action_at(1).try_as<add_action>()->_payload == 1);
+    FLOW_CHECK(s, history.action_at(2).try_as<add_action>()->_payload == 10);
+    FLOW_CHECK(s, history.action_at(3).try_as<add_action>()->_payload == 100);
+    FLOW_CHECK(s, history.state_at(store, 2) == 11);
+    subscription.dispose();
+  });
+}
+
+}  // namespace test
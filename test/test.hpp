@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include <flowcpp/flow.h>
+
+namespace test {
+
+// Runs the tests whose name contains the filter and counts the failed checks. A failed check reports its location and
+// the test goes on, so one run shows every failure.
+class suite {
+ public:
+  explicit suite(std::string filter) : _filter(std::move(filter)) {}
+
+  template <class F>
+  void run(const std::string &name, F &&test) {
+    if (name.find(_filter) == std::string::npos) return;
+    auto failures_before = _failures;
+    ++_ran;
+    _current = name;
+    test();
+    std::cout << (_failures == failures_before ? "ok    " : "FAIL  ") << name << std::endl;
+  }
+
+  void check(bool ok, const char *expression, const char *file, int line) {
+    if (ok) return;
+    ++_failures;
+    std::cout << file << ":" << line << ": " << _current << ": check failed: " << expression << std::endl;
+  }
+
+  std::size_t failures() const { return _failures; }
+
+  std::size_t ran() const { return _ran; }
+
+ private:
+  std::string _filter;
+  std::string _current;
+  std::size_t _failures{0};
+  std::size_t _ran{0};
+};
+
+#define FLOW_CHECK(s, condition) (s).check(static_cast<bool>(condition), #condition, __FILE__, __LINE__)
+
+struct add_action {
+  flow::any payload() const { return _payload; }
+  flow::any type() const { return {}; }
+  flow::any meta() const { return {}; }
+  bool error() const { return false; }
+
+  int _payload = {1};
+};
+
+struct reject_action {
+  flow::any payload() const { return {}; }
+  flow::any type() const { return {}; }
+  flow::any meta() const { return {}; }
+  bool error() const { return false; }
+};
+
+struct counter_state {
+  long count{0};
+  long sum{0};
+};
+
+// Adds the payload of add_action, throws on reject_action before touching the state.
+inline void counter_reducer(counter_state &state, const flow::action &action) {
+  if (action.try_as<reject_action>()) throw std::runtime_error("rejected");
+  if (auto add = action.try_as<add_action>()) {
+    ++state.count;
+    state.sum = state.sum * 31 % 1000003 + add->_payload;
+  }
+}
+
+void concurrent_store_tests(suite &s);
+void store_tests(suite &s);
+void persistent_tests(suite &s);
+void journal_tests(suite &s);
+void any_tests(suite &s);
+void type_id_map_tests(suite &s);
+void async_tests(suite &s);
+void instrumentation_tests(suite &s);
+
+}  // namespace test
@@ -0,0 +1,60 @@
+#include <stdexcept>
+#include <utility>
+
+#include "test.hpp"
+
+namespace test {
+namespace {
+
+template <int N>
+struct tag {};
+
+template <int... N>
+void insert_tags(flow::type_id_map<int> &map, std::integer_sequence<int, N...>) {
+  int dummy[] = {(map[flow::type_id<tag<N>>()] = N + 1)..., 0};
+  (void)dummy;
+}
+
+template <int... N>
+bool finds_tags(const flow::type_id_map<int> &map, std::integer_sequence<int, N...>) {
+  bool found[] = {(map.find(flow::type_id<tag<N>>()) && *map.find(flow::type_id<tag<N>>()) == N + 1)..., true};
+  for (auto f : found) {
+    if (!f) return false;
+  }
+  return true;
+}
+
+template <int... N>
+bool misses_tags(const flow::type_id_map<int> &map, std::integer_sequence<int, N...>) {
+  bool missed[] = {!map.find(flow::type_id<tag<N + 100>>())..., true};
+  for (auto m : missed) {
+    if (!m) return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+void type_id_map_tests(suite &s) {
+  s.run("type_id_map/find_only_inserted_ids", [&] {
+    flow::type_id_map<int> map;
+    FLOW_CHECK(s, !map.find(nullptr));
+
+    insert_tags(map, std::make_integer_sequence<int, 20>{});
+    FLOW_CHECK(s, map.size() == 20);
+    FLOW_CHECK(s, finds_tags(map, std::make_integer_sequence<int, 20>{}));
+    FLOW_CHECK(s, misses_tags(map, std::make_integer_sequence<int, 20>{}));
+    FLOW_CHECK(s, !map.find(nullptr));
+
+    auto threw = false;
+    try {
+      map[nullptr];
+    } catch (const std::invalid_argument &) {
+      threw = true;
+    }
+    FLOW_CHECK(s, threw);
+    FLOW_CHECK(s, map.size() == 20);
+  });
+}
+
+}  // namespace test